@@ -233,6 +233,36 @@ static inline void s2e_get_int_overflow_example(void* buf, int size)
     );
 }
 
+/** 同s2e_get_int_overflow_example，但只检查无符号溢出（如size_t运算），查询更小. */
+static inline void s2e_get_int_overflow_example_unsigned(void* buf, int size)
+{
+    __s2e_touch_buffer(buf, size);
+    __asm__ __volatile__(
+        "pushl %%ebx\n"
+        "movl %%edx, %%ebx\n"
+        ".byte 0x0f, 0x3f\n"
+        ".byte 0x00, 0x80, 0x01, 0x00\n"
+        ".byte 0x00, 0x00, 0x00, 0x00\n"
+        "popl %%ebx\n"
+        : : "a" (buf), "d" (size) : "memory"
+    );
+}
+
+/** 同s2e_get_int_overflow_example，但只检查有符号溢出. */
+static inline void s2e_get_int_overflow_example_signed(void* buf, int size)
+{
+    __s2e_touch_buffer(buf, size);
+    __asm__ __volatile__(
+        "pushl %%ebx\n"
+        "movl %%edx, %%ebx\n"
+        ".byte 0x0f, 0x3f\n"
+        ".byte 0x00, 0x80, 0x02, 0x00\n"
+        ".byte 0x00, 0x00, 0x00, 0x00\n"
+        "popl %%ebx\n"
+        : : "a" (buf), "d" (size) : "memory"
+    );
+}
+
 
 
 /** Get example value for expression (without adding state constraints). */
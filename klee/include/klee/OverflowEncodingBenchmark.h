@@ -0,0 +1,40 @@
+//===-- OverflowEncodingBenchmark.h -----------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_OVERFLOWENCODINGBENCHMARK_H
+#define KLEE_OVERFLOWENCODINGBENCHMARK_H
+
+#include "klee/Expr.h"
+#include "klee/util/OverflowPredicates.h"
+
+namespace klee {
+  class ConstraintManager;
+
+  /// Measures the solver time of every overflow encoding on the nodes
+  /// actually checked during a run (-overflow-encoding-benchmark), and
+  /// optionally records the queries as a KQuery corpus
+  /// (-overflow-query-corpus) to be replayed offline with kleaver.
+  ///
+  /// Times go to the OEk/OEs/OEw statistics. Encodings disagreeing on a
+  /// node are counted in OEm; the predicates are meant to be equivalent.
+  class OverflowEncodingBenchmark {
+  public:
+    /// True if either benchmarking or corpus recording is enabled.
+    static bool isEnabled();
+
+    /// Builds the predicate of \a node under every encoding, solves each
+    /// one against \a constraints on the calling thread, with one solver
+    /// instance of the benchmark's own and no time limit, and records the
+    /// solver time per encoding.
+    static void run(const ConstraintManager &constraints,
+                    const ref<Expr> &node, OverflowSignedness mode);
+  };
+}
+
+#endif
@@ -0,0 +1,40 @@
+//===-- OverflowStats.h -----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_OVERFLOWSTATS_H
+#define KLEE_OVERFLOWSTATS_H
+
+#include "klee/Statistic.h"
+
+namespace klee {
+namespace stats {
+
+  extern Statistic overflowCacheLookups;
+  extern Statistic overflowCacheHits;
+  extern Statistic overflowVerdictLookups;
+  extern Statistic overflowVerdictHits;
+  extern Statistic overflowRangeDischarged;
+  extern Statistic overflowFoldedPredicates;
+  extern Statistic sliceConstraintsIn;
+  extern Statistic sliceConstraintsKept;
+  extern Statistic overflowUnknown;
+  extern Statistic overflowSolverTimeUnsigned;
+  extern Statistic overflowSolverTimeSigned;
+  extern Statistic overflowSolverTimeBoth;
+  extern Statistic overflowEncodingTimeKint;
+  extern Statistic overflowEncodingTimeSignBit;
+  extern Statistic overflowEncodingTimeWiden;
+  extern Statistic overflowEncodingMismatches;
+  extern Statistic visitorTraversalTime;
+  extern Statistic visitorStaticTraversalTime;
+
+}
+}
+
+#endif
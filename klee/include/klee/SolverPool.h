@@ -0,0 +1,154 @@
+//===-- SolverPool.h --------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_SOLVERPOOL_H
+#define KLEE_SOLVERPOOL_H
+
+#include "klee/Expr.h"
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace klee {
+  class ConstraintManager;
+  class Solver;
+
+  /// A pool of solver processes answering mayBeTrue queries concurrently.
+  /// STP is not reentrant and expressions are not thread safe, so queries
+  /// are serialized (ExprSerializer) and answered by helper processes, each
+  /// with a solver chain of its own kept from one query to the next. The
+  /// pool has no thread: the thread using it (the executor thread) forks
+  /// the helpers, hands them the queries, kills a helper running past the
+  /// deadline of its query, to restart it when next needed, and collects
+  /// the answers whenever it calls into the pool. The pool is therefore not
+  /// thread safe. Results are retrieved per ticket, which lets callers
+  /// consume them in submission order whatever the completion order.
+  class SolverPool {
+  public:
+    typedef uint64_t Ticket;
+
+    /// TimedOut: the query failed after using up its time limit, i.e. the
+    /// answer is unknown rather than an error.
+    enum Verdict { Failed, MayBeTrue, AlwaysFalse, TimedOut };
+
+    struct Result {
+      Verdict verdict;
+      /// Values of the arrays read by the query (by array name) satisfying
+      /// the constraints and the expression, if a model was requested and
+      /// the verdict is MayBeTrue.
+      std::vector< std::pair<std::string, std::vector<unsigned char> > > model;
+
+      Result() : verdict(Failed) {}
+    };
+
+  private:
+    struct Job;
+
+    /// A helper process and the job it is solving, if any.
+    struct Helper {
+      /// 0 when the process is not running.
+      pid_t pid;
+      /// The pool's end of the socket connected to the process.
+      int fd;
+      Job *job;
+      /// Wall time at which the job runs out of time (0: no limit).
+      double deadline;
+
+      Helper() : pid(0), fd(-1), job(0), deadline(0) {}
+    };
+
+    std::vector<Helper> helpers;
+    std::deque<Job*> pending;
+    /// Only served when pending is empty.
+    std::deque<Job*> lowPriority;
+    std::map<Ticket, Result> finished;
+    Ticket nextTicket;
+
+    /// Drops the job of \a ticket from \a queue.
+    bool removePending(std::deque<Job*> &queue, Ticket ticket);
+    bool isQueued(Ticket ticket) const;
+
+    /// Forks the process of \a helper.
+    static bool spawn(Helper &helper);
+    /// Kills the process of \a helper, if running.
+    static void stop(Helper &helper);
+    /// The loop of a helper process, answering the queries read from \a fd.
+    static void serve(int fd);
+    static Result solve(Solver *solver, const ConstraintManager &constraints,
+                        const ref<Expr> &expr, bool wantModel);
+
+    /// Hands queued jobs to idle helpers, starting helpers as needed.
+    void dispatch();
+    /// Waits for at most \a timeout seconds (negative: no limit) for a
+    /// helper to answer or to run out of time, collects the answers and
+    /// the timeouts, and dispatches the jobs left.
+    void progress(double timeout);
+    void complete(Helper &helper, const Result &result);
+
+    SolverPool(const SolverPool&);
+    void operator=(const SolverPool&);
+
+  public:
+    /// Starts \a numProcesses helpers.
+    explicit SolverPool(unsigned numProcesses);
+    ~SolverPool();
+
+    /// The pool configured with -overflow-solver-processes, or null when
+    /// queries are to be solved on the executor thread.
+    static SolverPool *get();
+
+    unsigned getNumProcesses() const { return helpers.size(); }
+
+    /// Time limits of overflow and sink checks, in seconds (0: no limit):
+    /// per solver query (-overflow-query-timeout), per checked site
+    /// (-overflow-site-budget), and for the low-priority retry of a query
+    /// that timed out (-overflow-retry-timeout, 0 disables retries).
+    static double getQueryTimeout();
+    static double getSiteBudget();
+    static double getRetryTimeout();
+
+    /// Time limit of the next query of a site with \a remaining seconds of
+    /// budget left (0: the site has no budget): the query timeout or the
+    /// remaining budget, whichever is shorter, 0 if neither applies.
+    static double getQueryLimit(double remaining);
+
+    /// Answers the query at once, in a helper process kept for such queries, so that \a timeout can be enforced: the
+    /// executor's solver cannot be interrupted.
+    static Result solveNow(const ConstraintManager &constraints,
+                           const ref<Expr> &expr, double timeout,
+                           bool wantModel = false);
+
+    /// Queues "may \a expr be true under \a constraints". With \a wantModel,
+    /// a satisfying assignment is computed as well. Low priority queries are
+    /// only started when no normal query is waiting.
+    Ticket submit(const ConstraintManager &constraints, const ref<Expr> &expr,
+                  bool wantModel = false, double timeout = 0,
+                  bool lowPriority = false);
+
+    /// Blocks until the query of \a ticket is answered, or for at most
+    /// \a timeout seconds (0: no limit), after which the ticket is discarded
+    /// and the result is TimedOut. Fails at once for an unknown ticket.
+    Result wait(Ticket ticket, double timeout = 0);
+
+    /// Returns true and the result if \a ticket has been answered.
+    bool poll(Ticket ticket, Result &result);
+
+    /// Gives up on \a ticket: it is dropped if not started yet, the helper
+    /// solving it is killed if it is running, and its result is thrown away
+    /// otherwise.
+    void discard(Ticket ticket);
+  };
+}
+
+#endif
@@ -0,0 +1,71 @@
+//===-- ConstraintSlicer.h --------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_CONSTRAINTSLICER_H
+#define KLEE_CONSTRAINTSLICER_H
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+
+#include <map>
+#include <vector>
+
+namespace klee {
+  class Array;
+
+  /// Keeps only the constraints that transitively share symbolic arrays
+  /// with a query expression. Assuming the whole constraint set is
+  /// satisfiable, the expression may be true under the slice iff it may be
+  /// true under the whole set, so sink and overflow queries about a length
+  /// field do not carry the unrelated constraints of a long parse.
+  ///
+  /// The partition of the arrays (union-find) is cached per constraint set
+  /// and extended incrementally as constraints are appended. A set whose
+  /// already indexed prefix changed (constraints get rewritten when an
+  /// equality is added) is re-indexed from scratch.
+  class ConstraintSlicer {
+    struct Index {
+      /// The constraints indexed so far, used to validate the prefix.
+      std::vector< ref<Expr> > constraints;
+      /// One array of each constraint (null if it reads none), standing
+      /// for the class of all arrays read by that constraint.
+      std::vector<const Array*> classes;
+      /// Union-find parent links.
+      std::map<const Array*, const Array*> parent;
+    };
+
+    typedef std::map<const ConstraintManager*, Index> indices_ty;
+    indices_ty indices;
+    unsigned maxSets;
+
+    const Array *find(Index &index, const Array *array);
+    void merge(Index &index, const Array *a, const Array *b);
+    Index &update(const ConstraintManager &constraints);
+
+  public:
+    explicit ConstraintSlicer(unsigned _maxSets) : maxSets(_maxSets) {}
+
+    /// The slicer shared by all plugins.
+    static ConstraintSlicer &get();
+
+    /// Returns the constraints of \a constraints relevant to \a expr, in
+    /// their original order.
+    ConstraintManager slice(const ConstraintManager &constraints,
+                            const ref<Expr> &expr);
+
+    /// Drops the index of \a constraints, e.g. when its state terminates.
+    void forget(const ConstraintManager &constraints) {
+      indices.erase(&constraints);
+    }
+
+    void clear() { indices.clear(); }
+  };
+}
+
+#endif
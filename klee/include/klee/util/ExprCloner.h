@@ -0,0 +1,55 @@
+//===-- ExprCloner.h --------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_EXPRCLONER_H
+#define KLEE_EXPRCLONER_H
+
+#include "klee/Expr.h"
+#include "klee/util/ExprHashMap.h"
+
+#include <map>
+#include <vector>
+
+namespace klee {
+  /// Deep-copies expressions, including their update lists and arrays, so
+  /// that the copies share no reference counted object and no array with
+  /// the originals. Arrays cache the state of the first solver that saw
+  /// them in place: a query for a solver instance other than the one of
+  /// the executor must be cloned first.
+  ///
+  /// The cloner owns the cloned arrays: it must outlive every expression it
+  /// produced.
+  class ExprCloner {
+    ExprHashMap< ref<Expr> > clones;
+    std::map<const UpdateNode*, const UpdateNode*> nodes;
+    std::map<const Array*, const Array*> arrays;
+    std::vector<const Array*> ownedArrays;
+
+    const Array *cloneArray(const Array *array);
+    UpdateList cloneUpdates(const UpdateList &updates);
+    ref<Expr> build(const ref<Expr> &e);
+
+    ExprCloner(const ExprCloner&);
+    void operator=(const ExprCloner&);
+
+  public:
+    ExprCloner() {}
+    ~ExprCloner();
+
+    /// Returns a deep copy of \a e. Structurally equal subexpressions cloned
+    /// by the same cloner share their copy.
+    ref<Expr> clone(const ref<Expr> &e);
+
+    /// Drops every reference to the original expressions, which the cloner
+    /// would otherwise keep alive as long as the clones.
+    void forgetOriginals();
+  };
+}
+
+#endif
@@ -0,0 +1,219 @@
+//===-- ExprIOStaticVisitor.h -----------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Statically dispatched counterpart of ExprIOVisitor. Derived classes
+// (CRTP) hide the visitXxx handlers they care about; the handlers they do
+// not declare resolve to the inline defaults below and fold away, so a
+// visitor that only handles arithmetic pays for nothing else.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_EXPRIOSTATICVISITOR_H
+#define KLEE_EXPRIOSTATICVISITOR_H
+
+#include "klee/util/ExprIOVisitor.h"
+
+#include <vector>
+
+namespace klee {
+  template<class Derived>
+  class ExprIOStaticVisitor {
+  public:
+    /// Same semantics as for the virtual visitor.
+    typedef ExprIOVisitor::Action Action;
+
+  private:
+    struct Frame {
+      ref<Expr> expr;
+      size_t resultBase;
+      unsigned nextKid;
+
+      Frame(const ref<Expr> &_expr, size_t _resultBase)
+        : expr(_expr), resultBase(_resultBase), nextKid(0) {}
+    };
+
+    ExprHashMap< ref<Expr> > visited;
+    std::vector<Frame> frames;
+    std::vector< ref<Expr> > results;
+
+    Derived &derived() { return static_cast<Derived&>(*this); }
+
+    void done(const ref<Expr> &e, const ref<Expr> &res) {
+      visited.insert(std::make_pair(e, res));
+      results.push_back(res);
+    }
+
+    void enter(const ref<Expr> &e) {
+      if (isa<ConstantExpr>(e)) {
+        results.push_back(e);
+        return;
+      }
+
+      typename ExprHashMap< ref<Expr> >::iterator it = visited.find(e);
+      if (it != visited.end()) {
+        results.push_back(it->second);
+        return;
+      }
+
+      Action res = derived().visitExpr(*e.get());
+      if (res.kind == Action::DoChildren)
+        res = dispatch(*e.get());
+
+      switch (res.kind) {
+      case Action::DoChildren:
+        frames.push_back(Frame(e, results.size()));
+        return;
+      case Action::SkipChildren:
+        done(e, e);
+        return;
+      case Action::ChangeTo:
+        done(e, res.argument);
+        return;
+      }
+    }
+
+  public:
+    Action visitExpr(const Expr&) { return Action::doChildren(); }
+    Action visitExprPost(const Expr&) { return Action::skipChildren(); }
+
+    Action visitNotOptimized(const NotOptimizedExpr&) { return Action::doChildren(); }
+    Action visitRead(const ReadExpr&) { return Action::doChildren(); }
+    Action visitSelect(const SelectExpr&) { return Action::doChildren(); }
+    Action visitConcat(const ConcatExpr&) { return Action::doChildren(); }
+    Action visitExtract(const ExtractExpr&) { return Action::doChildren(); }
+    Action visitZExt(const ZExtExpr&) { return Action::doChildren(); }
+    Action visitSExt(const SExtExpr&) { return Action::doChildren(); }
+    Action visitAdd(const AddExpr&) { return Action::doChildren(); }
+    Action visitSub(const SubExpr&) { return Action::doChildren(); }
+    Action visitMul(const MulExpr&) { return Action::doChildren(); }
+    Action visitUDiv(const UDivExpr&) { return Action::doChildren(); }
+    Action visitSDiv(const SDivExpr&) { return Action::doChildren(); }
+    Action visitURem(const URemExpr&) { return Action::doChildren(); }
+    Action visitSRem(const SRemExpr&) { return Action::doChildren(); }
+    Action visitNot(const NotExpr&) { return Action::doChildren(); }
+    Action visitAnd(const AndExpr&) { return Action::doChildren(); }
+    Action visitOr(const OrExpr&) { return Action::doChildren(); }
+    Action visitXor(const XorExpr&) { return Action::doChildren(); }
+    Action visitShl(const ShlExpr&) { return Action::doChildren(); }
+    Action visitLShr(const LShrExpr&) { return Action::doChildren(); }
+    Action visitAShr(const AShrExpr&) { return Action::doChildren(); }
+    Action visitEq(const EqExpr&) { return Action::doChildren(); }
+    Action visitNe(const NeExpr&) { return Action::doChildren(); }
+    Action visitUlt(const UltExpr&) { return Action::doChildren(); }
+    Action visitUle(const UleExpr&) { return Action::doChildren(); }
+    Action visitUgt(const UgtExpr&) { return Action::doChildren(); }
+    Action visitUge(const UgeExpr&) { return Action::doChildren(); }
+    Action visitSlt(const SltExpr&) { return Action::doChildren(); }
+    Action visitSle(const SleExpr&) { return Action::doChildren(); }
+    Action visitSgt(const SgtExpr&) { return Action::doChildren(); }
+    Action visitSge(const SgeExpr&) { return Action::doChildren(); }
+
+    /// Calls the derived handler for the kind of \a e.
+    Action dispatch(const Expr &e) {
+      Derived &d = derived();
+      switch (e.getKind()) {
+      case Expr::NotOptimized: return d.visitNotOptimized(static_cast<const NotOptimizedExpr&>(e));
+      case Expr::Read: return d.visitRead(static_cast<const ReadExpr&>(e));
+      case Expr::Select: return d.visitSelect(static_cast<const SelectExpr&>(e));
+      case Expr::Concat: return d.visitConcat(static_cast<const ConcatExpr&>(e));
+      case Expr::Extract: return d.visitExtract(static_cast<const ExtractExpr&>(e));
+      case Expr::ZExt: return d.visitZExt(static_cast<const ZExtExpr&>(e));
+      case Expr::SExt: return d.visitSExt(static_cast<const SExtExpr&>(e));
+      case Expr::Add: return d.visitAdd(static_cast<const AddExpr&>(e));
+      case Expr::Sub: return d.visitSub(static_cast<const SubExpr&>(e));
+      case Expr::Mul: return d.visitMul(static_cast<const MulExpr&>(e));
+      case Expr::UDiv: return d.visitUDiv(static_cast<const UDivExpr&>(e));
+      case Expr::SDiv: return d.visitSDiv(static_cast<const SDivExpr&>(e));
+      case Expr::URem: return d.visitURem(static_cast<const URemExpr&>(e));
+      case Expr::SRem: return d.visitSRem(static_cast<const SRemExpr&>(e));
+      case Expr::Not: return d.visitNot(static_cast<const NotExpr&>(e));
+      case Expr::And: return d.visitAnd(static_cast<const AndExpr&>(e));
+      case Expr::Or: return d.visitOr(static_cast<const OrExpr&>(e));
+      case Expr::Xor: return d.visitXor(static_cast<const XorExpr&>(e));
+      case Expr::Shl: return d.visitShl(static_cast<const ShlExpr&>(e));
+      case Expr::LShr: return d.visitLShr(static_cast<const LShrExpr&>(e));
+      case Expr::AShr: return d.visitAShr(static_cast<const AShrExpr&>(e));
+      case Expr::Eq: return d.visitEq(static_cast<const EqExpr&>(e));
+      case Expr::Ne: return d.visitNe(static_cast<const NeExpr&>(e));
+      case Expr::Ult: return d.visitUlt(static_cast<const UltExpr&>(e));
+      case Expr::Ule: return d.visitUle(static_cast<const UleExpr&>(e));
+      case Expr::Ugt: return d.visitUgt(static_cast<const UgtExpr&>(e));
+      case Expr::Uge: return d.visitUge(static_cast<const UgeExpr&>(e));
+      case Expr::Slt: return d.visitSlt(static_cast<const SltExpr&>(e));
+      case Expr::Sle: return d.visitSle(static_cast<const SleExpr&>(e));
+      case Expr::Sgt: return d.visitSgt(static_cast<const SgtExpr&>(e));
+      case Expr::Sge: return d.visitSge(static_cast<const SgeExpr&>(e));
+      case Expr::Constant:
+      default:
+        assert(0 && "invalid expression kind");
+        return Action::skipChildren();
+      }
+    }
+
+    /// Applies the visitor to \a e only, without descending into its kids
+    /// (the counterpart of ExprIOVisitor::visitOutsideOp).
+    ref<Expr> visitOutside(const ref<Expr> &e) {
+      if (isa<ConstantExpr>(e))
+        return e;
+
+      Action res = derived().visitExpr(*e.get());
+      if (res.kind == Action::DoChildren)
+        res = dispatch(*e.get());
+      return res.kind == Action::ChangeTo ? res.argument : e;
+    }
+
+    /// Applies the visitor to the whole expression and returns the possibly
+    /// modified expression. Memoized and iterative, like ExprIOVisitor.
+    ref<Expr> visit(const ref<Expr> &e) {
+      size_t base = frames.size();
+
+      enter(e);
+      while (frames.size() > base) {
+        size_t top = frames.size() - 1;
+        Expr &ep = *frames[top].expr.get();
+        unsigned count = ep.getNumKids();
+        if (frames[top].nextKid < count) {
+          ref<Expr> kid = ep.getKid(frames[top].nextKid++);
+          enter(kid);
+          continue;
+        }
+
+        size_t kidsBase = frames[top].resultBase;
+        bool rebuild = false;
+        for (unsigned i = 0; i < count; i++) {
+          if (results[kidsBase + i] != ep.getKid(i))
+            rebuild = true;
+        }
+
+        ref<Expr> res(&ep);
+        if (rebuild)
+          res = ep.rebuild(&results[kidsBase]);
+        results.resize(kidsBase);
+
+        if (!isa<ConstantExpr>(res)) {
+          Action post = derived().visitExprPost(*res.get());
+          if (post.kind == Action::ChangeTo)
+            res = post.argument;
+        }
+
+        ref<Expr> key = frames[top].expr;
+        frames.pop_back();
+        done(key, res);
+      }
+
+      ref<Expr> res = results.back();
+      results.pop_back();
+      return res;
+    }
+
+    void resetVisited() { visited.clear(); }
+  };
+}
+
+#endif
@@ -11,6 +11,9 @@
 #define KLEE_EXPRIOVISITOR_H
 
 #include "ExprHashMap.h"
+#include "OverflowPredicates.h"
+
+#include <vector>
 
 namespace klee {
   class ExprIOVisitor {
@@ -42,7 +45,7 @@ namespace klee {
 
   public:
     explicit
-    ExprIOVisitor(bool _recursive=false) : recursive(_recursive) {}
+    ExprIOVisitor(bool _recursive=false) : recursive(_recursive), epoch(0) {}
     virtual ~ExprIOVisitor() {}
 
     virtual Action visitExpr(const Expr&);
@@ -84,14 +87,53 @@ namespace klee {
     typedef ExprHashMap< ref<Expr> > visited_ty;
     visited_ty visited;
     bool recursive;
+    /// Number of times the visited table was reset, either explicitly or
+    /// because it reached its size cap.
+    unsigned epoch;
+
+    /// A node whose children are being visited.
+    struct Frame {
+      ref<Expr> expr;
+      /// Position of the first kid result on the result stack.
+      size_t resultBase;
+      unsigned nextKid;
+      bool memoize;
+      /// Set while the rebuilt expression is re-visited (recursive mode).
+      bool revisiting;
+
+      Frame(const ref<Expr> &_expr, size_t _resultBase, bool _memoize)
+        : expr(_expr), resultBase(_resultBase), nextKid(0),
+          memoize(_memoize), revisiting(false) {}
+    };
 
-    ref<Expr> visitActual(const ref<Expr> &e);
+    /// Work buffers of the iterative traversal, kept to reuse their storage.
+    std::vector<Frame> frames;
+    std::vector< ref<Expr> > results;
+
+    Action dispatch(const Expr &e);
+    void enter(const ref<Expr> &e);
+    void leave(ref<Expr> res);
+    void done(const ref<Expr> &e, const ref<Expr> &res, bool memoize);
     
   public:
     // apply the visitor to the expression and return a possibly
     // modified new expression.
     ref<Expr> visit(const ref<Expr> &e);
-	ref<Expr> visitOutsideOp(const ref<Expr> &e); 
+    /// Returns the overflow predicate of the node \a e alone, checking the
+    /// given signedness, or e itself if it has no overflow semantics.
+    ref<Expr> visitOutsideOp(const ref<Expr> &e,
+                             OverflowSignedness mode = AnyOverflow);
+
+    /// Drops all memoized results and the expression references they hold,
+    /// starting a new epoch. Long-lived visitors should call this at points
+    /// where earlier results are no longer useful (e.g. per query).
+    void resetVisited();
+
+    unsigned getEpoch() const { return epoch; }
+    size_t getVisitedSize() const { return visited.size(); }
+    /// Approximate number of bytes used by the visited table itself, not
+    /// counting the expressions it keeps alive.
+    size_t getVisitedMemoryUsage() const;
   };
 }
 
@@ -0,0 +1,92 @@
+//===-- ExprSerializer.h ----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_EXPRSERIALIZER_H
+#define KLEE_EXPRSERIALIZER_H
+
+#include "klee/Expr.h"
+#include "klee/util/ExprHashMap.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace klee {
+  /// Writes expressions, with their update lists and arrays, to a byte
+  /// buffer that ExprDeserializer reads back in another process running
+  /// the same binary. Structurally equal subexpressions, update nodes and
+  /// arrays are written once and referred to by index afterwards.
+  class ExprSerializer {
+    std::vector<unsigned char> &out;
+    ExprHashMap<uint32_t> exprs;
+    std::map<const UpdateNode*, uint32_t> nodes;
+    std::map<const Array*, uint32_t> arrays;
+
+    void writeConstant(const llvm::APInt &value);
+    uint32_t writeArray(const Array *array);
+    /// Index of the head of \a updates plus one, 0 for an empty list.
+    uint32_t writeUpdates(const UpdateList &updates);
+    void writeExpr(const ref<Expr> &e);
+
+  public:
+    explicit ExprSerializer(std::vector<unsigned char> &_out) : out(_out) {}
+
+    /// Writes \a e and whatever it depends on that was not written yet,
+    /// and returns the index under which the deserializer will know it.
+    uint32_t write(const ref<Expr> &e);
+
+    /// Ends the expressions; the caller may append data of its own next.
+    void finish();
+
+    void writeWord(uint32_t value);
+    void writeBytes(const void *data, size_t size);
+  };
+
+  /// Reads what an ExprSerializer wrote. Not thread safe, like the
+  /// expressions it builds.
+  class ExprDeserializer {
+  public:
+    /// Arrays by name, shared by the deserializers of one process: an
+    /// array read by successive messages is the same Array object, so that
+    /// the solver state cached in arrays (and solver caches keyed on them)
+    /// carry over from one message to the next. The arrays are never freed.
+    typedef std::map<std::string, const Array*> ArrayTable;
+
+  private:
+    ArrayTable &table;
+    const unsigned char *pos, *end;
+    std::vector< ref<Expr> > exprs;
+    std::vector<const UpdateNode*> nodes;
+    std::vector<const Array*> arrays;
+
+    bool readArray();
+    bool readNode();
+    bool readExpr();
+    bool readConstant(ref<ConstantExpr> &result);
+    bool readIndex(uint32_t &index, size_t count);
+
+  public:
+    ExprDeserializer(ArrayTable &_table, const std::vector<unsigned char> &in)
+      : table(_table), pos(in.empty() ? 0 : &in[0]),
+        end(in.empty() ? 0 : &in[0] + in.size()) {}
+
+    /// Reads the expressions up to the end mark; false if the data is
+    /// malformed.
+    bool read();
+
+    /// The expression written with index \a index, or null.
+    ref<Expr> get(uint32_t index) const;
+
+    bool readWord(uint32_t &value);
+  };
+}
+
+#endif
@@ -0,0 +1,36 @@
+//===-- ExprVisitorBenchmark.h ----------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_EXPRVISITORBENCHMARK_H
+#define KLEE_EXPRVISITORBENCHMARK_H
+
+namespace llvm {
+  class raw_ostream;
+}
+
+namespace klee {
+  /// Times the expression visitors on synthetic expressions
+  /// (-expr-visitor-benchmark): a full ExprIOVisitor traversal of a chain
+  /// -expr-visitor-benchmark-depth nodes deep, the shape produced by
+  /// byte-by-byte input parsers, then the same traversal with the
+  /// statically dispatched ExprIOStaticVisitor.
+  ///
+  /// Times go to the VTt/VTs statistics and are printed to the given
+  /// stream.
+  class ExprVisitorBenchmark {
+  public:
+    static bool isEnabled();
+
+    /// Builds the expressions, runs every measurement once and frees the
+    /// expressions again without deep recursion.
+    static void run(llvm::raw_ostream &os);
+  };
+}
+
+#endif
@@ -0,0 +1,39 @@
+//===-- OverflowConstants.h -------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_OVERFLOWCONSTANTS_H
+#define KLEE_OVERFLOWCONSTANTS_H
+
+#include "klee/Expr.h"
+
+namespace klee {
+  /// The constants overflow predicates and sink conditions are made of,
+  /// built once per width (1 to 64 bits) and shared by every predicate
+  /// instead of being allocated on each call.
+  ///
+  /// The reference counts of the constants are not atomic: they may only
+  /// be used on the executor thread. Queries handed to the solver pool are
+  /// serialized (ExprSerializer) and rebuilt by the solver processes.
+  struct OverflowConstants {
+    ref<ConstantExpr> zero, one;
+    /// -1, i.e. UINT_MAX: the same object under both names.
+    ref<ConstantExpr> negOne, umax;
+    ref<ConstantExpr> smin, smax;
+    /// The width itself and width - 1, as shift amounts.
+    ref<ConstantExpr> width, widthMinusOne;
+
+    /// The constants of width \a w, which must be in [1, 64].
+    static const OverflowConstants &get(Expr::Width w);
+
+  private:
+    explicit OverflowConstants(Expr::Width w);
+  };
+}
+
+#endif
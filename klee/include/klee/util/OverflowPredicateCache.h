@@ -0,0 +1,100 @@
+//===-- OverflowPredicateCache.h --------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_OVERFLOWPREDICATECACHE_H
+#define KLEE_OVERFLOWPREDICATECACHE_H
+
+#include "klee/Expr.h"
+#include "klee/util/ExprHashMap.h"
+#include "klee/util/OverflowPredicates.h"
+
+#include <list>
+#include <vector>
+
+#include <stdint.h>
+
+namespace klee {
+  class ConstraintManager;
+
+  /// Process-wide, size-bounded (LRU) cache mapping an arithmetic node to
+  /// its overflow predicate and to the verdict of the last solver query on
+  /// that predicate. Nodes are keyed structurally, so the same expression
+  /// checked from a loop or from sibling states shares one entry. Verdicts
+  /// are only valid under the constraint set they were computed with, which
+  /// is stored with the verdict (see getConstraintKey()): lookups compare
+  /// fingerprints first and the constraints themselves only when those
+  /// match. There is one cache per signedness mode, the mode being part of
+  /// the key.
+  class OverflowPredicateCache {
+  public:
+    enum Verdict { Unknown, MayOverflow, CannotOverflow };
+
+    /// A constraint set and its fingerprint, an order-independent 64-bit
+    /// hash of the constraints.
+    struct ConstraintKey {
+      uint64_t fingerprint;
+      std::vector< ref<Expr> > constraints;
+
+      ConstraintKey() : fingerprint(0) {}
+
+      /// True if both keys hold the same constraints, in any order.
+      bool operator==(const ConstraintKey &other) const;
+      bool operator!=(const ConstraintKey &other) const {
+        return !(*this == other);
+      }
+    };
+
+  private:
+    struct Entry {
+      ref<Expr> predicate;
+      ConstraintKey constraints;
+      Verdict verdict;
+      std::list< ref<Expr> >::iterator lru;
+    };
+
+    typedef ExprHashMap<Entry> entries_ty;
+    entries_ty entries;
+    /// Most recently used node first.
+    std::list< ref<Expr> > lru;
+    unsigned capacity;
+    OverflowSignedness mode;
+
+    /// Finds or creates (building the predicate) the entry of \a node and
+    /// marks it most recently used.
+    Entry &lookup(const ref<Expr> &node, bool &hit);
+
+  public:
+    OverflowPredicateCache(unsigned _capacity, OverflowSignedness _mode)
+      : capacity(_capacity), mode(_mode) {}
+
+    /// The cache of predicates checking \a mode, shared by all visitors and
+    /// plugins.
+    static OverflowPredicateCache &get(OverflowSignedness mode = AnyOverflow);
+
+    /// Returns the overflow predicate of \a node, building it on a miss.
+    /// A null ref means node has no overflow semantics.
+    ref<Expr> getPredicate(const ref<Expr> &node);
+
+    /// Returns the last verdict recorded for \a node under exactly the
+    /// constraint set \a constraints, or Unknown.
+    Verdict getVerdict(const ref<Expr> &node, const ConstraintKey &constraints);
+    void setVerdict(const ref<Expr> &node, const ConstraintKey &constraints,
+                    Verdict verdict);
+
+    /// The key of \a constraints, in linear time: the fingerprint is built
+    /// from the hashes the expressions cache, and does not depend on the
+    /// order in which the constraints were added.
+    static ConstraintKey getConstraintKey(const ConstraintManager &constraints);
+
+    unsigned size() const { return entries.size(); }
+    void clear();
+  };
+}
+
+#endif
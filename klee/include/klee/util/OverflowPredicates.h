@@ -0,0 +1,393 @@
+//===-- OverflowPredicates.h ------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Width-generic integer overflow predicates. Each supported operand width
+// (8, 16, 32 and 64 bits) gets its own specialization so that the limits of
+// the type and the widened type used for exact multiplication are known at
+// compile time; no pow()/double arithmetic is involved when building a
+// predicate.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_OVERFLOWPREDICATES_H
+#define KLEE_OVERFLOWPREDICATES_H
+
+#include "klee/Expr.h"
+#include "klee/util/OverflowConstants.h"
+
+#include <stdint.h>
+#include <string>
+
+namespace klee {
+
+  /// Which overflow semantics a predicate checks for Add, Sub, Mul and Shl.
+  /// Checking only the semantics of the source operation (e.g. unsigned for
+  /// size_t arithmetic) keeps the other half out of the query. Divisions
+  /// are signed or unsigned by kind and ignore it.
+  enum OverflowSignedness {
+    UnsignedOverflow = 1,
+    SignedOverflow = 2,
+    AnyOverflow = UnsignedOverflow | SignedOverflow
+  };
+
+  /// How the predicates of Add, Sub, Mul and SDiv are written. All of them
+  /// are equivalent; they only differ in what the solver has to bit-blast.
+  ///   KintEncoding:    xor sign tests (Add/Sub), 2W-bit product (Mul),
+  ///                    l == INT_MIN && r == -1 (SDiv).
+  ///   SignBitEncoding: sign comparisons of operands and result (Add/Sub),
+  ///                    division of the result (Mul), quotient == l (SDiv).
+  ///   WidenEncoding:   the operation redone on 2W bits by ZExt/SExt and
+  ///                    compared with the W-bit range (Add/Sub/Mul).
+  /// The KINT product is the widened one, so Mul has only two forms.
+  /// SRem uses the SDiv form, with l / r as the quotient.
+  enum OverflowEncoding {
+    KintEncoding,
+    SignBitEncoding,
+    WidenEncoding,
+    NumOverflowEncodings
+  };
+
+  /// Native types backing an integer of width W.
+  template<Expr::Width W> struct IntWidthTypes;
+
+  template<> struct IntWidthTypes<Expr::Int8> {
+    typedef uint8_t  utype;
+    typedef int8_t   stype;
+    typedef uint16_t wide_utype;
+    typedef int16_t  wide_stype;
+  };
+
+  template<> struct IntWidthTypes<Expr::Int16> {
+    typedef uint16_t utype;
+    typedef int16_t  stype;
+    typedef uint32_t wide_utype;
+    typedef int32_t  wide_stype;
+  };
+
+  template<> struct IntWidthTypes<Expr::Int32> {
+    typedef uint32_t utype;
+    typedef int32_t  stype;
+    typedef uint64_t wide_utype;
+    typedef int64_t  wide_stype;
+  };
+
+  template<> struct IntWidthTypes<Expr::Int64> {
+    typedef uint64_t    utype;
+    typedef int64_t     stype;
+    typedef __uint128_t wide_utype;
+    typedef __int128_t  wide_stype;
+  };
+
+  /// Compile-time limits and native overflow checks for width W. Values are
+  /// always passed around as uint64_t holding the two's complement bit
+  /// pattern of the W-bit integer.
+  template<Expr::Width W>
+  struct IntWidth : public IntWidthTypes<W> {
+    typedef typename IntWidthTypes<W>::utype      utype;
+    typedef typename IntWidthTypes<W>::stype      stype;
+    typedef typename IntWidthTypes<W>::wide_utype wide_utype;
+    typedef typename IntWidthTypes<W>::wide_stype wide_stype;
+
+    static const Expr::Width width = W;
+    static const Expr::Width wideWidth = 2 * W;
+    /// UINT_MAX, as a bit pattern.
+    static const uint64_t umax = (uint64_t) (utype) ~(utype) 0;
+    /// INT_MAX, as a bit pattern.
+    static const uint64_t smax = umax >> 1;
+    /// INT_MIN, as a bit pattern.
+    static const uint64_t smin = smax + 1;
+
+    static bool uaddOverflow(uint64_t a, uint64_t b) {
+      return (utype) ((utype) a + (utype) b) < (utype) a;
+    }
+    static bool saddOverflow(uint64_t a, uint64_t b) {
+      wide_stype r = (wide_stype) (stype) a + (wide_stype) (stype) b;
+      return r != (wide_stype) (stype) r;
+    }
+    static bool usubOverflow(uint64_t a, uint64_t b) {
+      return (utype) a < (utype) b;
+    }
+    static bool ssubOverflow(uint64_t a, uint64_t b) {
+      wide_stype r = (wide_stype) (stype) a - (wide_stype) (stype) b;
+      return r != (wide_stype) (stype) r;
+    }
+    static bool umulOverflow(uint64_t a, uint64_t b) {
+      wide_utype r = (wide_utype) (utype) a * (wide_utype) (utype) b;
+      return r > (wide_utype) umax;
+    }
+    static bool smulOverflow(uint64_t a, uint64_t b) {
+      wide_stype r = (wide_stype) (stype) a * (wide_stype) (stype) b;
+      return r != (wide_stype) (stype) r;
+    }
+    static bool sdivOverflow(uint64_t a, uint64_t b) {
+      return (utype) b == 0 || ((utype) a == smin && (utype) b == umax);
+    }
+    static bool shlOverflow(uint64_t a, uint64_t b) {
+      if ((utype) b >= W)
+        return true;
+      return (utype) ((utype) ((utype) a << (utype) b) >> (utype) b) != (utype) a;
+    }
+  };
+
+  template<Expr::Width W> const Expr::Width IntWidth<W>::width;
+  template<Expr::Width W> const Expr::Width IntWidth<W>::wideWidth;
+  template<Expr::Width W> const uint64_t IntWidth<W>::umax;
+  template<Expr::Width W> const uint64_t IntWidth<W>::smax;
+  template<Expr::Width W> const uint64_t IntWidth<W>::smin;
+
+  /// Symbolic overflow predicates for operands of width W. Every builder
+  /// returns a boolean expression which is true iff the operation
+  /// overflows (or traps, for divisions).
+  template<Expr::Width W>
+  class OverflowPredicate {
+    typedef IntWidth<W> Int;
+
+    static const OverflowConstants &k() {
+      static const OverflowConstants &constants = OverflowConstants::get(W);
+      return constants;
+    }
+
+    static ref<Expr> either(const ref<Expr> &condu, const ref<Expr> &conds) {
+      if (condu.isNull())
+        return conds;
+      if (conds.isNull())
+        return condu;
+      return OrExpr::create(condu, conds);
+    }
+
+    typedef ref<Expr> (*BinaryBuilder)(const ref<Expr> &, const ref<Expr> &);
+
+    /// Redoes \a op on 2W bits: the zero-extended result must not exceed
+    /// UINT_MAX, the sign-extended one must survive a truncate/sign-extend
+    /// round trip.
+    static ref<Expr> widened(BinaryBuilder op, const ref<Expr> &l,
+                             const ref<Expr> &r, OverflowSignedness mode) {
+      static const ref<Expr> wideUmax =
+        ConstantExpr::create(Int::umax, Int::wideWidth);
+      ref<Expr> condu, conds;
+      if (mode & UnsignedOverflow)
+        condu = UltExpr::create(
+            wideUmax,
+            op(ZExtExpr::create(l, Int::wideWidth),
+               ZExtExpr::create(r, Int::wideWidth)));
+      if (mode & SignedOverflow) {
+        ref<Expr> swide = op(SExtExpr::create(l, Int::wideWidth),
+                             SExtExpr::create(r, Int::wideWidth));
+        conds = NeExpr::create(
+            SExtExpr::create(ExtractExpr::create(swide, 0, W), Int::wideWidth),
+            swide);
+      }
+      return either(condu, conds);
+    }
+
+    static ref<Expr> isNegative(const ref<Expr> &v) {
+      return SltExpr::create(v, k().zero);
+    }
+
+    static ref<Expr> isNotNegative(const ref<Expr> &v) {
+      return SleExpr::create(k().zero, v);
+    }
+
+  public:
+    /// Unsigned: res <u l. Signed (KINT): ((res ^ l) & (res ^ r)) <s 0;
+    /// (sign bit): l, r >= 0 && res < 0 || l, r < 0 && res >= 0.
+    static ref<Expr> add(const ref<Expr> &l, const ref<Expr> &r,
+                         const ref<Expr> &res,
+                         OverflowSignedness mode = AnyOverflow,
+                         OverflowEncoding encoding = KintEncoding) {
+      if (encoding == WidenEncoding)
+        return widened(&AddExpr::create, l, r, mode);
+
+      ref<Expr> condu, conds;
+      if (mode & UnsignedOverflow)
+        condu = UltExpr::create(res, l);
+      if ((mode & SignedOverflow) && encoding == SignBitEncoding)
+        conds = OrExpr::create(
+            AndExpr::create(AndExpr::create(isNotNegative(l), isNotNegative(r)),
+                            isNegative(res)),
+            AndExpr::create(AndExpr::create(isNegative(l), isNegative(r)),
+                            isNotNegative(res)));
+      else if (mode & SignedOverflow)
+        conds = SltExpr::create(
+            AndExpr::create(XorExpr::create(res, l), XorExpr::create(res, r)),
+            k().zero);
+      return either(condu, conds);
+    }
+
+    /// Unsigned: l <u r. Signed (KINT): ((res ^ l) & (l ^ r)) <s 0;
+    /// (sign bit): l >= 0 && r < 0 && res < 0 || l < 0 && r >= 0 && res >= 0.
+    static ref<Expr> sub(const ref<Expr> &l, const ref<Expr> &r,
+                         const ref<Expr> &res,
+                         OverflowSignedness mode = AnyOverflow,
+                         OverflowEncoding encoding = KintEncoding) {
+      // A borrow wraps the 2W-bit difference above UINT_MAX as well.
+      if (encoding == WidenEncoding)
+        return widened(&SubExpr::create, l, r, mode);
+
+      ref<Expr> condu, conds;
+      if (mode & UnsignedOverflow)
+        condu = UltExpr::create(l, r);
+      if ((mode & SignedOverflow) && encoding == SignBitEncoding)
+        conds = OrExpr::create(
+            AndExpr::create(AndExpr::create(isNotNegative(l), isNegative(r)),
+                            isNegative(res)),
+            AndExpr::create(AndExpr::create(isNegative(l), isNotNegative(r)),
+                            isNotNegative(res)));
+      else if (mode & SignedOverflow)
+        conds = SltExpr::create(
+            AndExpr::create(XorExpr::create(res, l), XorExpr::create(l, r)),
+            k().zero);
+      return either(condu, conds);
+    }
+
+    /// Exact check through a 2W-bit product: the unsigned product must fit
+    /// in W bits, the signed product must survive a truncate/sign-extend
+    /// round trip. The sign-bit encoding stays on W bits and divides the
+    /// result instead: l != 0 && res / l != r, where the signed quotient
+    /// also wraps for l == -1 && r == INT_MIN.
+    static ref<Expr> mul(const ref<Expr> &l, const ref<Expr> &r,
+                         const ref<Expr> &res,
+                         OverflowSignedness mode = AnyOverflow,
+                         OverflowEncoding encoding = KintEncoding) {
+      if (encoding != SignBitEncoding)
+        return widened(&MulExpr::create, l, r, mode);
+
+      ref<Expr> nonZero = NeExpr::create(k().zero, l);
+      ref<Expr> condu, conds;
+      if (mode & UnsignedOverflow)
+        condu = AndExpr::create(nonZero,
+                                NeExpr::create(UDivExpr::create(res, l), r));
+      if (mode & SignedOverflow)
+        conds = OrExpr::create(
+            AndExpr::create(nonZero,
+                            NeExpr::create(SDivExpr::create(res, l), r)),
+            AndExpr::create(
+                EqExpr::create(k().negOne, l),
+                EqExpr::create(k().smin, r)));
+      return either(condu, conds);
+    }
+
+    /// r == 0 || (l == INT_MIN && r == -1). The sign-bit encoding tests the
+    /// quotient instead, r == 0 || (q == l && l != 0 && r == -1), when it is
+    /// given.
+    static ref<Expr> sdiv(const ref<Expr> &l, const ref<Expr> &r,
+                          const ref<Expr> &q = ref<Expr>(),
+                          OverflowEncoding encoding = KintEncoding) {
+      const OverflowConstants &c = k();
+      ref<Expr> divByZero = EqExpr::create(c.zero, r);
+      if (encoding == SignBitEncoding && !q.isNull())
+        return OrExpr::create(
+            divByZero,
+            AndExpr::create(AndExpr::create(EqExpr::create(q, l),
+                                            NeExpr::create(c.zero, l)),
+                            EqExpr::create(c.negOne, r)));
+
+      ref<Expr> intMinByNeg1 = AndExpr::create(
+          EqExpr::create(c.smin, l),
+          EqExpr::create(c.negOne, r));
+      return OrExpr::create(divByZero, intMinByNeg1);
+    }
+
+    /// r == 0.
+    static ref<Expr> udiv(const ref<Expr> &r) {
+      return EqExpr::create(k().zero, r);
+    }
+
+    /// Bits shifted out, i.e. shifting back does not give l: unsigned
+    /// (res >>u r) != l, signed (res >>s r) != l. Or a shift amount >= W.
+    static ref<Expr> shl(const ref<Expr> &l, const ref<Expr> &r,
+                         const ref<Expr> &res,
+                         OverflowSignedness mode = AnyOverflow) {
+      ref<Expr> lostu, losts;
+      if (mode & UnsignedOverflow)
+        lostu = UltExpr::create(LShrExpr::create(res, r), l);
+      if (mode & SignedOverflow)
+        losts = NeExpr::create(AShrExpr::create(res, r), l);
+      ref<Expr> tooFar = UleExpr::create(k().width, r);
+      return OrExpr::create(either(lostu, losts), tooFar);
+    }
+
+    /// v does not fit the signed range of W, i.e. v >u INT_MAX.
+    static ref<Expr> exceedsSignedMax(const ref<Expr> &v) {
+      return UltExpr::create(k().smax, v);
+    }
+  };
+
+  /// Runtime entry points dispatching on the operand width. Only 8, 16, 32
+  /// and 64-bit operands are supported; any other width yields a null ref.
+  class OverflowPredicates {
+  public:
+    static bool isSupportedWidth(Expr::Width w) {
+      return w == Expr::Int8 || w == Expr::Int16 ||
+             w == Expr::Int32 || w == Expr::Int64;
+    }
+
+    /// Returns the overflow predicate of the arithmetic node \a e, or a
+    /// null ref if e's kind (or width) has no overflow semantics.
+    /// The predicates use the encoding selected with -overflow-encoding.
+    static ref<Expr> build(const ref<Expr> &e,
+                           OverflowSignedness mode = AnyOverflow);
+    static ref<Expr> build(const ref<Expr> &e, OverflowSignedness mode,
+                           OverflowEncoding encoding);
+
+    static ref<Expr> add(const ref<Expr> &l, const ref<Expr> &r,
+                         const ref<Expr> &res,
+                         OverflowSignedness mode = AnyOverflow,
+                         OverflowEncoding encoding = KintEncoding);
+    static ref<Expr> sub(const ref<Expr> &l, const ref<Expr> &r,
+                         const ref<Expr> &res,
+                         OverflowSignedness mode = AnyOverflow,
+                         OverflowEncoding encoding = KintEncoding);
+    static ref<Expr> mul(const ref<Expr> &l, const ref<Expr> &r,
+                         const ref<Expr> &res,
+                         OverflowSignedness mode = AnyOverflow,
+                         OverflowEncoding encoding = KintEncoding);
+    static ref<Expr> sdiv(const ref<Expr> &l, const ref<Expr> &r,
+                          const ref<Expr> &q = ref<Expr>(),
+                          OverflowEncoding encoding = KintEncoding);
+    static ref<Expr> udiv(const ref<Expr> &r);
+    static ref<Expr> shl(const ref<Expr> &l, const ref<Expr> &r,
+                         const ref<Expr> &res,
+                         OverflowSignedness mode = AnyOverflow);
+    static ref<Expr> exceedsSignedMax(const ref<Expr> &v);
+
+    /// Returns true if the conversion node \a e (Extract, ZExt, SExt) gets
+    /// a predicate in \a mode (see -overflow-check-conversions). Only
+    /// truncations of a wider value to 16 bits or more (8-bit extracts are
+    /// how values are split into bytes for memory) and extensions of 16 to
+    /// 64-bit values are checked. ZExt is only checked for SignedOverflow,
+    /// where the source is known to be signed; SExt of a negative value is
+    /// checked for UnsignedOverflow and AnyOverflow.
+    static bool checksConversion(const ref<Expr> &e, OverflowSignedness mode);
+
+    /// \a src truncated to its low \a w bits loses its value: unsigned, the
+    /// high bits are not zero; signed, it does not survive a sign-extend
+    /// round trip.
+    static ref<Expr> truncation(const ref<Expr> &src, Expr::Width w,
+                                OverflowSignedness mode = AnyOverflow);
+
+    /// \a src is negative, i.e. changes value when converted between signed
+    /// and unsigned.
+    static ref<Expr> signConversion(const ref<Expr> &src);
+
+    /// Parses "unsigned", "signed" or "both" (the default for anything else).
+    static OverflowSignedness parseSignedness(const std::string &s);
+    static const char *getSignednessName(OverflowSignedness mode);
+
+    /// The encoding selected with -overflow-encoding (kint by default).
+    static OverflowEncoding getEncoding();
+    static const char *getEncodingName(OverflowEncoding encoding);
+
+    /// Returns true if the Expr builders folded \a predicate to a constant,
+    /// storing its value in \a value. Such predicates need no solver query.
+    static bool isFolded(const ref<Expr> &predicate, bool &value);
+  };
+}
+
+#endif
@@ -0,0 +1,84 @@
+//===-- OverflowRangeAnalysis.h ---------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Cheap abstract interpretation over an expression DAG (known bits plus an
+// unsigned interval, from which the signed interval is derived) used to
+// prove that an arithmetic node cannot overflow before any overflow
+// predicate is built or any solver query is issued. Simple range
+// constraints of the state (x < C, x >= C, x == C, ...) seed the analysis.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_OVERFLOWRANGEANALYSIS_H
+#define KLEE_OVERFLOWRANGEANALYSIS_H
+
+#include "klee/Expr.h"
+#include "klee/util/ExprHashMap.h"
+#include "klee/util/OverflowPredicates.h"
+
+#include <stdint.h>
+
+namespace klee {
+  class ConstraintManager;
+
+  /// Over-approximation of the values of an expression of width <= 64.
+  /// All fields are bit patterns restricted to the width of the expression.
+  struct BitRange {
+    uint64_t knownZero, knownOne;
+    uint64_t umin, umax;
+
+    static uint64_t mask(Expr::Width w) {
+      return w >= 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << w) - 1;
+    }
+    static BitRange top(Expr::Width w);
+    static BitRange constant(uint64_t v, Expr::Width w);
+    static BitRange interval(uint64_t lo, uint64_t hi, Expr::Width w);
+
+    /// Tightens the interval with the known bits and vice versa.
+    void normalize(Expr::Width w);
+
+    /// Signed interval, as sign-extended values.
+    int64_t smin(Expr::Width w) const;
+    int64_t smax(Expr::Width w) const;
+  };
+
+  class OverflowRangeAnalysis {
+    ExprHashMap<BitRange> ranges;
+    /// Bounds taken from the constraints, applied on top of the computed
+    /// range of the constrained expression.
+    ExprHashMap<BitRange> seeds;
+
+    void seed(const ref<Expr> &e, uint64_t lo, uint64_t hi);
+    BitRange compute(const ref<Expr> &e);
+
+  public:
+    OverflowRangeAnalysis() {}
+    explicit OverflowRangeAnalysis(const ConstraintManager &constraints);
+
+    /// Records the bounds implied by \a constraint, if it has a simple form.
+    void addConstraint(const ref<Expr> &constraint);
+
+    /// Returns true if the analysis can handle \a e (width 1..64).
+    static bool isSupported(const ref<Expr> &e) {
+      return e->getWidth() > 0 && e->getWidth() <= 64;
+    }
+
+    /// Range of \a e, which must be supported.
+    const BitRange &get(const ref<Expr> &e);
+
+    /// Returns true if the arithmetic node \a e provably cannot overflow
+    /// in the semantics selected by \a mode, nor trap, or if the checked
+    /// conversion node \a e provably keeps its value. False means
+    /// "unknown".
+    bool provesNoOverflow(const ref<Expr> &e,
+                          OverflowSignedness mode = AnyOverflow);
+  };
+}
+
+#endif
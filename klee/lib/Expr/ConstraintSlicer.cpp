@@ -0,0 +1,118 @@
+//===-- ConstraintSlicer.cpp ----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/ConstraintSlicer.h"
+
+#include "klee/OverflowStats.h"
+#include "klee/util/ExprUtil.h"
+
+#include "llvm/Support/CommandLine.h"
+
+#include <set>
+
+using namespace klee;
+
+namespace {
+  llvm::cl::opt<unsigned>
+  SlicerMaxSets("constraint-slicer-max-sets",
+                llvm::cl::desc("Maximum number of constraint sets whose "
+                               "array partition is kept by the constraint "
+                               "slicer (0 disables slicing)."),
+                llvm::cl::init(64));
+}
+
+ConstraintSlicer &ConstraintSlicer::get() {
+  static ConstraintSlicer slicer(SlicerMaxSets);
+  return slicer;
+}
+
+const Array *ConstraintSlicer::find(Index &index, const Array *array) {
+  std::map<const Array*, const Array*>::iterator it = index.parent.find(array);
+  if (it == index.parent.end()) {
+    index.parent.insert(std::make_pair(array, array));
+    return array;
+  }
+
+  // Path halving.
+  while (it->second != it->first) {
+    std::map<const Array*, const Array*>::iterator up =
+      index.parent.find(it->second);
+    it->second = up->second;
+    it = index.parent.find(it->second);
+  }
+  return it->first;
+}
+
+void ConstraintSlicer::merge(Index &index, const Array *a, const Array *b) {
+  a = find(index, a);
+  b = find(index, b);
+  if (a != b)
+    index.parent[a] = b;
+}
+
+ConstraintSlicer::Index &
+ConstraintSlicer::update(const ConstraintManager &constraints) {
+  indices_ty::iterator it = indices.find(&constraints);
+  if (it == indices.end()) {
+    if (indices.size() >= maxSets)
+      indices.clear();
+    it = indices.insert(std::make_pair(&constraints, Index())).first;
+  }
+  Index &index = it->second;
+
+  // The indexed prefix must be unchanged, otherwise start over.
+  ConstraintManager::const_iterator ci = constraints.begin(),
+    ce = constraints.end();
+  size_t n = 0;
+  if (constraints.size() >= index.constraints.size()) {
+    for (; n < index.constraints.size(); ++n, ++ci)
+      if (ci->get() != index.constraints[n].get())
+        break;
+  }
+  if (n != index.constraints.size()) {
+    index = Index();
+    ci = constraints.begin();
+  }
+
+  std::vector<const Array*> arrays;
+  for (; ci != ce; ++ci) {
+    arrays.clear();
+    findSymbolicObjects(*ci, arrays);
+    for (unsigned i = 1; i < arrays.size(); ++i)
+      merge(index, arrays[0], arrays[i]);
+    index.constraints.push_back(*ci);
+    index.classes.push_back(arrays.empty() ? 0 : arrays[0]);
+  }
+  return index;
+}
+
+ConstraintManager ConstraintSlicer::slice(const ConstraintManager &constraints,
+                                          const ref<Expr> &expr) {
+  if (maxSets == 0 || isa<ConstantExpr>(expr))
+    return constraints;
+
+  Index &index = update(constraints);
+
+  std::vector<const Array*> arrays;
+  findSymbolicObjects(expr, arrays);
+  std::set<const Array*> roots;
+  for (unsigned i = 0; i < arrays.size(); ++i)
+    roots.insert(find(index, arrays[i]));
+
+  std::vector< ref<Expr> > result;
+  for (unsigned i = 0; i < index.classes.size(); ++i) {
+    const Array *array = index.classes[i];
+    if (array && roots.count(find(index, array)))
+      result.push_back(index.constraints[i]);
+  }
+
+  stats::sliceConstraintsIn += index.constraints.size();
+  stats::sliceConstraintsKept += result.size();
+  return ConstraintManager(result);
+}
@@ -0,0 +1,123 @@
+//===-- ExprCloner.cpp ----------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/ExprCloner.h"
+
+using namespace klee;
+
+ExprCloner::~ExprCloner() {
+  clones.clear();
+  for (unsigned i = 0; i < ownedArrays.size(); ++i)
+    delete ownedArrays[i];
+}
+
+void ExprCloner::forgetOriginals() {
+  clones.clear();
+  nodes.clear();
+  arrays.clear();
+}
+
+const Array *ExprCloner::cloneArray(const Array *array) {
+  std::map<const Array*, const Array*>::iterator it = arrays.find(array);
+  if (it != arrays.end())
+    return it->second;
+
+  std::vector< ref<ConstantExpr> > values;
+  for (unsigned i = 0; i < array->constantValues.size(); ++i)
+    values.push_back(ConstantExpr::alloc(array->constantValues[i]->getAPValue()));
+
+  const Array *res;
+  if (values.empty())
+    res = new Array(array->name, array->size);
+  else
+    res = new Array(array->name, array->size,
+                    &values[0], &values[0] + values.size());
+  ownedArrays.push_back(res);
+  arrays.insert(std::make_pair(array, res));
+  return res;
+}
+
+UpdateList ExprCloner::cloneUpdates(const UpdateList &updates) {
+  // Nodes not cloned yet, newest first. The indices and values are already
+  // cloned (see clone()).
+  std::vector<const UpdateNode*> chain;
+  const UpdateNode *next = 0;
+  for (const UpdateNode *un = updates.head; un; un = un->next) {
+    std::map<const UpdateNode*, const UpdateNode*>::iterator it = nodes.find(un);
+    if (it != nodes.end()) {
+      next = it->second;
+      break;
+    }
+    chain.push_back(un);
+  }
+
+  for (unsigned i = chain.size(); i > 0; --i) {
+    const UpdateNode *un = chain[i - 1];
+    next = new UpdateNode(next, clones.find(un->index)->second,
+                          clones.find(un->value)->second);
+    nodes.insert(std::make_pair(un, next));
+  }
+
+  return UpdateList(cloneArray(updates.root), next);
+}
+
+ref<Expr> ExprCloner::build(const ref<Expr> &e) {
+  if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(e))
+    return ConstantExpr::alloc(ce->getAPValue());
+
+  if (const ReadExpr *re = dyn_cast<ReadExpr>(e))
+    return ReadExpr::alloc(cloneUpdates(re->updates),
+                           clones.find(re->index)->second);
+
+  ref<Expr> kids[8];
+  unsigned count = e->getNumKids();
+  assert(count <= 8 && "too many kids");
+  for (unsigned i = 0; i < count; ++i)
+    kids[i] = clones.find(e->getKid(i))->second;
+  return e->rebuild(kids);
+}
+
+ref<Expr> ExprCloner::clone(const ref<Expr> &root) {
+  ExprHashMap< ref<Expr> >::iterator it = clones.find(root);
+  if (it != clones.end())
+    return it->second;
+
+  // Iterative post-order walk. The update lists of a read are dependencies
+  // of the read, like its index.
+  std::vector< std::pair<ref<Expr>, bool> > stack;
+  stack.push_back(std::make_pair(root, false));
+  while (!stack.empty()) {
+    ref<Expr> e = stack.back().first;
+    if (clones.count(e)) {
+      stack.pop_back();
+      continue;
+    }
+
+    if (!stack.back().second) {
+      stack.back().second = true;
+      for (unsigned i = 0; i < e->getNumKids(); ++i)
+        if (!clones.count(e->getKid(i)))
+          stack.push_back(std::make_pair(e->getKid(i), false));
+      if (const ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+        for (const UpdateNode *un = re->updates.head; un; un = un->next) {
+          if (nodes.count(un))
+            break;
+          stack.push_back(std::make_pair(un->index, false));
+          stack.push_back(std::make_pair(un->value, false));
+        }
+      }
+      continue;
+    }
+
+    stack.pop_back();
+    clones.insert(std::make_pair(e, build(e)));
+  }
+
+  return clones.find(root)->second;
+}
@@ -0,0 +1,362 @@
+//===-- ExprSerializer.cpp ------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/ExprSerializer.h"
+
+#include <string.h>
+
+using namespace klee;
+
+/// Records, each introduced by its tag. Indices refer to earlier records of
+/// the same kind, in the order they were written.
+///   Array: name size and bytes, size, number of constant values, values
+///   Node:  next node (index + 1, 0 for none), index expr, value expr
+///   Expr:  kind, then for a constant its value, for a read its array, its
+///          head node (index + 1, 0 for none) and its index expr, for any
+///          other kind its width, extract offset (0 otherwise), number of
+///          kids and kid exprs
+/// Constants are written as a width, a number of 64-bit words and the words.
+enum RecordTag { EndTag, ArrayTag, NodeTag, ExprTag };
+
+void ExprSerializer::writeWord(uint32_t value) {
+  writeBytes(&value, sizeof(value));
+}
+
+void ExprSerializer::writeBytes(const void *data, size_t size) {
+  const unsigned char *p = static_cast<const unsigned char*>(data);
+  out.insert(out.end(), p, p + size);
+}
+
+void ExprSerializer::writeConstant(const llvm::APInt &value) {
+  writeWord(value.getBitWidth());
+  writeWord(value.getNumWords());
+  writeBytes(value.getRawData(), value.getNumWords() * sizeof(uint64_t));
+}
+
+uint32_t ExprSerializer::writeArray(const Array *array) {
+  std::map<const Array*, uint32_t>::iterator it = arrays.find(array);
+  if (it != arrays.end())
+    return it->second;
+
+  writeWord(ArrayTag);
+  writeWord(array->name.size());
+  writeBytes(array->name.data(), array->name.size());
+  writeWord(array->size);
+  writeWord(array->constantValues.size());
+  for (unsigned i = 0; i < array->constantValues.size(); ++i)
+    writeConstant(array->constantValues[i]->getAPValue());
+
+  uint32_t index = arrays.size();
+  arrays.insert(std::make_pair(array, index));
+  return index;
+}
+
+uint32_t ExprSerializer::writeUpdates(const UpdateList &updates) {
+  // Nodes not written yet, newest first. Their indices and values are
+  // written already (see write()).
+  std::vector<const UpdateNode*> chain;
+  uint32_t next = 0;
+  for (const UpdateNode *un = updates.head; un; un = un->next) {
+    std::map<const UpdateNode*, uint32_t>::iterator it = nodes.find(un);
+    if (it != nodes.end()) {
+      next = it->second + 1;
+      break;
+    }
+    chain.push_back(un);
+  }
+
+  for (unsigned i = chain.size(); i > 0; --i) {
+    const UpdateNode *un = chain[i - 1];
+    writeWord(NodeTag);
+    writeWord(next);
+    writeWord(exprs.find(un->index)->second);
+    writeWord(exprs.find(un->value)->second);
+    uint32_t index = nodes.size();
+    nodes.insert(std::make_pair(un, index));
+    next = index + 1;
+  }
+  return next;
+}
+
+void ExprSerializer::writeExpr(const ref<Expr> &e) {
+  if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(e)) {
+    writeWord(ExprTag);
+    writeWord(Expr::Constant);
+    writeConstant(ce->getAPValue());
+  } else if (const ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+    uint32_t array = writeArray(re->updates.root);
+    uint32_t head = writeUpdates(re->updates);
+    writeWord(ExprTag);
+    writeWord(Expr::Read);
+    writeWord(array);
+    writeWord(head);
+    writeWord(exprs.find(re->index)->second);
+  } else {
+    writeWord(ExprTag);
+    writeWord(e->getKind());
+    writeWord(e->getWidth());
+    const ExtractExpr *ee = dyn_cast<ExtractExpr>(e);
+    writeWord(ee ? ee->offset : 0);
+    writeWord(e->getNumKids());
+    for (unsigned i = 0; i < e->getNumKids(); ++i)
+      writeWord(exprs.find(e->getKid(i))->second);
+  }
+
+  uint32_t index = exprs.size();
+  exprs.insert(std::make_pair(e, index));
+}
+
+uint32_t ExprSerializer::write(const ref<Expr> &root) {
+  ExprHashMap<uint32_t>::iterator it = exprs.find(root);
+  if (it != exprs.end())
+    return it->second;
+
+  // Iterative post-order walk, as in ExprCloner: the update lists of a read
+  // are dependencies of the read, like its index.
+  std::vector< std::pair<ref<Expr>, bool> > stack;
+  stack.push_back(std::make_pair(root, false));
+  while (!stack.empty()) {
+    ref<Expr> e = stack.back().first;
+    if (exprs.count(e)) {
+      stack.pop_back();
+      continue;
+    }
+
+    if (!stack.back().second) {
+      stack.back().second = true;
+      for (unsigned i = 0; i < e->getNumKids(); ++i)
+        if (!exprs.count(e->getKid(i)))
+          stack.push_back(std::make_pair(e->getKid(i), false));
+      if (const ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+        for (const UpdateNode *un = re->updates.head; un; un = un->next) {
+          if (nodes.count(un))
+            break;
+          stack.push_back(std::make_pair(un->index, false));
+          stack.push_back(std::make_pair(un->value, false));
+        }
+      }
+      continue;
+    }
+
+    stack.pop_back();
+    writeExpr(e);
+  }
+
+  return exprs.find(root)->second;
+}
+
+void ExprSerializer::finish() {
+  writeWord(EndTag);
+}
+
+bool ExprDeserializer::readWord(uint32_t &value) {
+  if ((size_t) (end - pos) < sizeof(value))
+    return false;
+  memcpy(&value, pos, sizeof(value));
+  pos += sizeof(value);
+  return true;
+}
+
+bool ExprDeserializer::readIndex(uint32_t &index, size_t count) {
+  return readWord(index) && index < count;
+}
+
+bool ExprDeserializer::readConstant(ref<ConstantExpr> &result) {
+  uint32_t width, numWords;
+  if (!readWord(width) || !readWord(numWords) || width == 0 ||
+      numWords != (width + 63) / 64 ||
+      (size_t) (end - pos) < numWords * sizeof(uint64_t))
+    return false;
+
+  std::vector<uint64_t> words(numWords);
+  memcpy(&words[0], pos, numWords * sizeof(uint64_t));
+  pos += numWords * sizeof(uint64_t);
+  result = ConstantExpr::alloc(llvm::APInt(width, numWords, &words[0]));
+  return true;
+}
+
+static bool isSameArray(const Array *array, uint32_t size,
+                        const std::vector< ref<ConstantExpr> > &values) {
+  if (array->size != size || array->constantValues.size() != values.size())
+    return false;
+  for (unsigned i = 0; i < values.size(); ++i)
+    if (array->constantValues[i]->compare(*values[i]))
+      return false;
+  return true;
+}
+
+bool ExprDeserializer::readArray() {
+  uint32_t nameSize, size, count;
+  if (!readWord(nameSize) || (size_t) (end - pos) < nameSize)
+    return false;
+  std::string name(reinterpret_cast<const char*>(pos), nameSize);
+  pos += nameSize;
+  if (!readWord(size) || !readWord(count))
+    return false;
+
+  std::vector< ref<ConstantExpr> > values;
+  for (unsigned i = 0; i < count; ++i) {
+    ref<ConstantExpr> value;
+    if (!readConstant(value))
+      return false;
+    values.push_back(value);
+  }
+
+  ArrayTable::iterator it = table.find(name);
+  if (it != table.end() && isSameArray(it->second, size, values)) {
+    arrays.push_back(it->second);
+    return true;
+  }
+
+  // An array replaced under the same name is not freed either: expressions
+  // cached by the solver may still read it.
+  const Array *array;
+  if (values.empty())
+    array = new Array(name, size);
+  else
+    array = new Array(name, size, &values[0], &values[0] + values.size());
+  table[name] = array;
+  arrays.push_back(array);
+  return true;
+}
+
+bool ExprDeserializer::readNode() {
+  uint32_t next, index, value;
+  if (!readWord(next) || next > nodes.size() ||
+      !readIndex(index, exprs.size()) || !readIndex(value, exprs.size()))
+    return false;
+  nodes.push_back(new UpdateNode(next ? nodes[next - 1] : 0,
+                                 exprs[index], exprs[value]));
+  return true;
+}
+
+bool ExprDeserializer::readExpr() {
+  uint32_t kind;
+  if (!readWord(kind))
+    return false;
+
+  if (kind == Expr::Constant) {
+    ref<ConstantExpr> value;
+    if (!readConstant(value))
+      return false;
+    exprs.push_back(value);
+    return true;
+  }
+
+  if (kind == Expr::Read) {
+    uint32_t array, head, index;
+    if (!readIndex(array, arrays.size()) || !readWord(head) ||
+        head > nodes.size() || !readIndex(index, exprs.size()))
+      return false;
+    UpdateList updates(arrays[array], head ? nodes[head - 1] : 0);
+    exprs.push_back(ReadExpr::alloc(updates, exprs[index]));
+    return true;
+  }
+
+  uint32_t width, offset, numKids;
+  if (!readWord(width) || !readWord(offset) || !readWord(numKids))
+    return false;
+
+  unsigned arity;
+  switch (kind) {
+  case Expr::NotOptimized:
+  case Expr::Extract:
+  case Expr::ZExt:
+  case Expr::SExt:
+  case Expr::Not:
+    arity = 1;
+    break;
+  case Expr::Select:
+    arity = 3;
+    break;
+  default:
+    arity = 2;
+    break;
+  }
+  if (numKids != arity)
+    return false;
+
+  ref<Expr> kids[3];
+  for (unsigned i = 0; i < numKids; ++i) {
+    uint32_t kid;
+    if (!readIndex(kid, exprs.size()))
+      return false;
+    kids[i] = exprs[kid];
+  }
+
+  // alloc() rather than create(): the expression is rebuilt as it was
+  // written, without being simplified again.
+  ref<Expr> e;
+  switch (kind) {
+  case Expr::NotOptimized: e = NotOptimizedExpr::alloc(kids[0]); break;
+  case Expr::Extract: e = ExtractExpr::alloc(kids[0], offset, width); break;
+  case Expr::ZExt: e = ZExtExpr::alloc(kids[0], width); break;
+  case Expr::SExt: e = SExtExpr::alloc(kids[0], width); break;
+  case Expr::Not: e = NotExpr::alloc(kids[0]); break;
+  case Expr::Select: e = SelectExpr::alloc(kids[0], kids[1], kids[2]); break;
+  case Expr::Concat: e = ConcatExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Add: e = AddExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Sub: e = SubExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Mul: e = MulExpr::alloc(kids[0], kids[1]); break;
+  case Expr::UDiv: e = UDivExpr::alloc(kids[0], kids[1]); break;
+  case Expr::SDiv: e = SDivExpr::alloc(kids[0], kids[1]); break;
+  case Expr::URem: e = URemExpr::alloc(kids[0], kids[1]); break;
+  case Expr::SRem: e = SRemExpr::alloc(kids[0], kids[1]); break;
+  case Expr::And: e = AndExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Or: e = OrExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Xor: e = XorExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Shl: e = ShlExpr::alloc(kids[0], kids[1]); break;
+  case Expr::LShr: e = LShrExpr::alloc(kids[0], kids[1]); break;
+  case Expr::AShr: e = AShrExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Eq: e = EqExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Ne: e = NeExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Ult: e = UltExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Ule: e = UleExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Ugt: e = UgtExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Uge: e = UgeExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Slt: e = SltExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Sle: e = SleExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Sgt: e = SgtExpr::alloc(kids[0], kids[1]); break;
+  case Expr::Sge: e = SgeExpr::alloc(kids[0], kids[1]); break;
+  default:
+    return false;
+  }
+  exprs.push_back(e);
+  return true;
+}
+
+bool ExprDeserializer::read() {
+  for (;;) {
+    uint32_t tag;
+    if (!readWord(tag))
+      return false;
+    switch (tag) {
+    case EndTag:
+      return true;
+    case ArrayTag:
+      if (!readArray())
+        return false;
+      break;
+    case NodeTag:
+      if (!readNode())
+        return false;
+      break;
+    case ExprTag:
+      if (!readExpr())
+        return false;
+      break;
+    default:
+      return false;
+    }
+  }
+}
+
+ref<Expr> ExprDeserializer::get(uint32_t index) const {
+  return index < exprs.size() ? exprs[index] : ref<Expr>();
+}
@@ -0,0 +1,133 @@
+//===-- ExprVisitorBenchmark.cpp ------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/ExprVisitorBenchmark.h"
+
+#include "klee/Expr.h"
+#include "klee/OverflowStats.h"
+#include "klee/util/ExprIOStaticVisitor.h"
+#include "klee/Internal/System/Time.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+  llvm::cl::opt<bool>
+  VisitorBenchmark("expr-visitor-benchmark",
+                   llvm::cl::desc("Time the expression visitors on synthetic "
+                                  "deep expressions at startup."),
+                   llvm::cl::init(false));
+
+  llvm::cl::opt<unsigned>
+  VisitorBenchmarkDepth("expr-visitor-benchmark-depth",
+                        llvm::cl::desc("Depth of the expression chain used by "
+                                       "-expr-visitor-benchmark."),
+                        llvm::cl::init(100000));
+
+  /// Counts the arithmetic nodes, through the virtual handlers.
+  class CountingVisitor : public ExprIOVisitor {
+  public:
+    unsigned nodes;
+
+    CountingVisitor() : nodes(0) {}
+
+    Action visitAdd(const AddExpr &) {
+      ++nodes;
+      return Action::doChildren();
+    }
+    Action visitMul(const MulExpr &) {
+      ++nodes;
+      return Action::doChildren();
+    }
+  };
+
+  /// Same as CountingVisitor, dispatched statically.
+  class StaticCountingVisitor
+    : public ExprIOStaticVisitor<StaticCountingVisitor> {
+  public:
+    unsigned nodes;
+
+    StaticCountingVisitor() : nodes(0) {}
+
+    Action visitAdd(const AddExpr &) {
+      ++nodes;
+      return Action::doChildren();
+    }
+    Action visitMul(const MulExpr &) {
+      ++nodes;
+      return Action::doChildren();
+    }
+  };
+}
+
+/// sum = (sum + zext(in[i % 256])) * 3, one Add and one Mul per byte. The
+/// intermediate results are kept in \a chain, newest last.
+static void buildChain(const Array *array, unsigned depth,
+                       std::vector< ref<Expr> > &chain) {
+  UpdateList ul(array, 0);
+  ref<Expr> three = ConstantExpr::create(3, Expr::Int32);
+  ref<Expr> sum = ConstantExpr::create(0, Expr::Int32);
+  chain.reserve(2 * depth);
+  for (unsigned i = 0; i < depth; ++i) {
+    ref<Expr> byte = ReadExpr::create(ul, ConstantExpr::create(i % 256,
+                                                               Expr::Int32));
+    sum = AddExpr::create(sum, ZExtExpr::create(byte, Expr::Int32));
+    chain.push_back(sum);
+    sum = MulExpr::create(sum, three);
+    chain.push_back(sum);
+  }
+}
+
+/// Releasing the root of a deep chain would free it recursively, one
+/// native frame per node. Dropping the newest node first frees one node at
+/// a time, its kid being still held by the chain.
+static void releaseChain(std::vector< ref<Expr> > &chain) {
+  while (!chain.empty())
+    chain.pop_back();
+}
+
+bool ExprVisitorBenchmark::isEnabled() {
+  return VisitorBenchmark;
+}
+
+void ExprVisitorBenchmark::run(llvm::raw_ostream &os) {
+  Array *array = new Array("expr_visitor_benchmark", 256);
+  std::vector< ref<Expr> > chain;
+  buildChain(array, VisitorBenchmarkDepth, chain);
+
+  {
+    CountingVisitor visitor;
+    double start = util::getWallTime();
+    visitor.visit(chain.back());
+    uint64_t elapsed = (uint64_t) ((util::getWallTime() - start) * 1000000);
+    stats::visitorTraversalTime += elapsed;
+    os << "ExprIOVisitor: " << visitor.nodes << " nodes, depth "
+       << chain.size() << ", " << elapsed << " us\n";
+    // The memoized results hold the chain too.
+    visitor.resetVisited();
+  }
+
+  {
+    StaticCountingVisitor visitor;
+    double start = util::getWallTime();
+    visitor.visit(chain.back());
+    uint64_t elapsed = (uint64_t) ((util::getWallTime() - start) * 1000000);
+    stats::visitorStaticTraversalTime += elapsed;
+    os << "ExprIOStaticVisitor: " << visitor.nodes << " nodes, depth "
+       << chain.size() << ", " << elapsed << " us\n";
+    visitor.resetVisited();
+  }
+
+  releaseChain(chain);
+  delete array;
+}
@@ -0,0 +1,35 @@
+//===-- OverflowConstants.cpp ---------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/OverflowConstants.h"
+
+#include <cassert>
+
+using namespace klee;
+
+OverflowConstants::OverflowConstants(Expr::Width w) {
+  uint64_t m = w >= 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << w) - 1;
+  zero = ConstantExpr::create(0, w);
+  one = ConstantExpr::create(1, w);
+  negOne = umax = ConstantExpr::create(m, w);
+  smax = ConstantExpr::create(m >> 1, w);
+  smin = ConstantExpr::create((m >> 1) + 1, w);
+  width = ConstantExpr::create(w, w);
+  widthMinusOne = ConstantExpr::create(w - 1, w);
+}
+
+const OverflowConstants &OverflowConstants::get(Expr::Width w) {
+  assert(w >= 1 && w <= 64 && "unsupported constant width");
+
+  // Built on first use and kept for the lifetime of the process.
+  static OverflowConstants *pool[65];
+  if (!pool[w])
+    pool[w] = new OverflowConstants(w);
+  return *pool[w];
+}
@@ -0,0 +1,149 @@
+//===-- OverflowPredicateCache.cpp ----------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/OverflowPredicateCache.h"
+
+#include "klee/Constraints.h"
+#include "klee/OverflowStats.h"
+#include "klee/util/ExprHashMap.h"
+#include "klee/util/OverflowPredicates.h"
+
+#include "llvm/Support/CommandLine.h"
+
+using namespace klee;
+
+namespace {
+  llvm::cl::opt<unsigned>
+  OverflowCacheSize("overflow-cache-size",
+                    llvm::cl::desc("Maximum number of arithmetic nodes whose "
+                                   "overflow predicate is cached (0 disables "
+                                   "the cache)."),
+                    llvm::cl::init(4096));
+}
+
+OverflowPredicateCache &OverflowPredicateCache::get(OverflowSignedness mode) {
+  static OverflowPredicateCache unsignedCache(OverflowCacheSize, UnsignedOverflow);
+  static OverflowPredicateCache signedCache(OverflowCacheSize, SignedOverflow);
+  static OverflowPredicateCache anyCache(OverflowCacheSize, AnyOverflow);
+  switch (mode) {
+  case UnsignedOverflow: return unsignedCache;
+  case SignedOverflow: return signedCache;
+  default: return anyCache;
+  }
+}
+
+OverflowPredicateCache::Entry &
+OverflowPredicateCache::lookup(const ref<Expr> &node, bool &hit) {
+  entries_ty::iterator it = entries.find(node);
+  hit = it != entries.end();
+  if (hit) {
+    lru.splice(lru.begin(), lru, it->second.lru);
+    return it->second;
+  }
+
+  if (entries.size() >= capacity) {
+    entries.erase(lru.back());
+    lru.pop_back();
+  }
+
+  lru.push_front(node);
+  Entry &entry = entries[node];
+  entry.predicate = OverflowPredicates::build(node, mode);
+  entry.verdict = Unknown;
+  entry.lru = lru.begin();
+  return entry;
+}
+
+ref<Expr> OverflowPredicateCache::getPredicate(const ref<Expr> &node) {
+  if (capacity == 0)
+    return OverflowPredicates::build(node, mode);
+
+  bool hit;
+  Entry &entry = lookup(node, hit);
+  ++stats::overflowCacheLookups;
+  if (hit)
+    ++stats::overflowCacheHits;
+  return entry.predicate;
+}
+
+OverflowPredicateCache::Verdict
+OverflowPredicateCache::getVerdict(const ref<Expr> &node,
+                                   const ConstraintKey &constraints) {
+  if (capacity == 0)
+    return Unknown;
+
+  ++stats::overflowVerdictLookups;
+  entries_ty::iterator it = entries.find(node);
+  if (it == entries.end() || it->second.verdict == Unknown ||
+      it->second.constraints != constraints)
+    return Unknown;
+
+  ++stats::overflowVerdictHits;
+  lru.splice(lru.begin(), lru, it->second.lru);
+  return it->second.verdict;
+}
+
+void OverflowPredicateCache::setVerdict(const ref<Expr> &node,
+                                        const ConstraintKey &constraints,
+                                        Verdict verdict) {
+  if (capacity == 0)
+    return;
+
+  bool hit;
+  Entry &entry = lookup(node, hit);
+  entry.constraints = constraints;
+  entry.verdict = verdict;
+}
+
+/// Spreads a 32-bit expression hash over 64 bits (the MurmurHash3
+/// finalizer), so that the sum of the hashes of a set is a usable
+/// fingerprint.
+static uint64_t mixHash(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+bool OverflowPredicateCache::ConstraintKey::operator==(
+    const ConstraintKey &other) const {
+  if (fingerprint != other.fingerprint ||
+      constraints.size() != other.constraints.size())
+    return false;
+  // Slices of the same constraint manager come in the same order, in which
+  // case the references are identical and compare in constant time.
+  if (constraints == other.constraints)
+    return true;
+
+  ExprHashSet set;
+  for (unsigned i = 0; i < constraints.size(); ++i)
+    set.insert(constraints[i]);
+  for (unsigned i = 0; i < other.constraints.size(); ++i)
+    if (!set.count(other.constraints[i]))
+      return false;
+  return true;
+}
+
+OverflowPredicateCache::ConstraintKey
+OverflowPredicateCache::getConstraintKey(const ConstraintManager &constraints) {
+  ConstraintKey key;
+  for (ConstraintManager::const_iterator it = constraints.begin(),
+         ie = constraints.end(); it != ie; ++it) {
+    key.constraints.push_back(*it);
+    key.fingerprint += mixHash((*it)->hash());
+  }
+  return key;
+}
+
+void OverflowPredicateCache::clear() {
+  entries.clear();
+  lru.clear();
+}
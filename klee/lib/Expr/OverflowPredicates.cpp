@@ -0,0 +1,270 @@
+//===-- OverflowPredicates.cpp --------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/OverflowPredicates.h"
+#include "klee/util/ExprIOStaticVisitor.h"
+#include "klee/OverflowStats.h"
+
+#include "llvm/Support/CommandLine.h"
+
+using namespace klee;
+
+namespace {
+  llvm::cl::opt<OverflowEncoding>
+  Encoding("overflow-encoding",
+           llvm::cl::desc("Encoding of the Add, Sub, Mul and SDiv overflow "
+                          "predicates:"),
+           llvm::cl::values(
+             clEnumValN(KintEncoding, "kint",
+                        "xor sign tests and 2W-bit products (default)"),
+             clEnumValN(SignBitEncoding, "signbit",
+                        "sign comparisons and division of the result"),
+             clEnumValN(WidenEncoding, "widen",
+                        "operation redone on 2W bits and range-checked; "
+                        "same as kint for Mul"),
+             clEnumValEnd),
+           llvm::cl::init(KintEncoding));
+
+  llvm::cl::opt<bool>
+  CheckConversions("overflow-check-conversions",
+                   llvm::cl::desc("Check truncations (Extract) and signedness "
+                                  "conversions (ZExt, SExt) for lost values."),
+                   llvm::cl::init(true));
+}
+
+// Instantiates OverflowPredicate<W>::CALL for the width of the operands, or
+// yields a null ref for widths without a specialization.
+#define DISPATCH_WIDTH(w, CALL)                                         \
+  switch (w) {                                                          \
+  case Expr::Int8:  return OverflowPredicate<Expr::Int8>::CALL;         \
+  case Expr::Int16: return OverflowPredicate<Expr::Int16>::CALL;        \
+  case Expr::Int32: return OverflowPredicate<Expr::Int32>::CALL;        \
+  case Expr::Int64: return OverflowPredicate<Expr::Int64>::CALL;        \
+  default:          return ref<Expr>();                                 \
+  }
+
+ref<Expr> OverflowPredicates::add(const ref<Expr> &l, const ref<Expr> &r,
+                                  const ref<Expr> &res,
+                                  OverflowSignedness mode,
+                                  OverflowEncoding encoding) {
+  DISPATCH_WIDTH(res->getWidth(), add(l, r, res, mode, encoding));
+}
+
+ref<Expr> OverflowPredicates::sub(const ref<Expr> &l, const ref<Expr> &r,
+                                  const ref<Expr> &res,
+                                  OverflowSignedness mode,
+                                  OverflowEncoding encoding) {
+  DISPATCH_WIDTH(res->getWidth(), sub(l, r, res, mode, encoding));
+}
+
+ref<Expr> OverflowPredicates::mul(const ref<Expr> &l, const ref<Expr> &r,
+                                  const ref<Expr> &res,
+                                  OverflowSignedness mode,
+                                  OverflowEncoding encoding) {
+  DISPATCH_WIDTH(l->getWidth(), mul(l, r, res, mode, encoding));
+}
+
+ref<Expr> OverflowPredicates::sdiv(const ref<Expr> &l, const ref<Expr> &r,
+                                   const ref<Expr> &q,
+                                   OverflowEncoding encoding) {
+  DISPATCH_WIDTH(l->getWidth(), sdiv(l, r, q, encoding));
+}
+
+ref<Expr> OverflowPredicates::udiv(const ref<Expr> &r) {
+  DISPATCH_WIDTH(r->getWidth(), udiv(r));
+}
+
+ref<Expr> OverflowPredicates::shl(const ref<Expr> &l, const ref<Expr> &r,
+                                  const ref<Expr> &res,
+                                  OverflowSignedness mode) {
+  DISPATCH_WIDTH(res->getWidth(), shl(l, r, res, mode));
+}
+
+ref<Expr> OverflowPredicates::exceedsSignedMax(const ref<Expr> &v) {
+  DISPATCH_WIDTH(v->getWidth(), exceedsSignedMax(v));
+}
+
+#undef DISPATCH_WIDTH
+
+bool OverflowPredicates::checksConversion(const ref<Expr> &e,
+                                          OverflowSignedness mode) {
+  if (!CheckConversions || isa<ConstantExpr>(e))
+    return false;
+
+  switch (e->getKind()) {
+  case Expr::Extract: {
+    const ExtractExpr *ee = cast<ExtractExpr>(e);
+    Expr::Width from = ee->expr->getWidth();
+    return ee->offset == 0 && ee->width >= Expr::Int16 &&
+           isSupportedWidth(ee->width) && from > ee->width && from <= 64;
+  }
+  case Expr::ZExt:
+  case Expr::SExt: {
+    Expr::Width from = e->getKid(0)->getWidth();
+    if (from < Expr::Int16 || !isSupportedWidth(from))
+      return false;
+    // A zero extension is only suspicious when the source is known to be
+    // signed; a negative value sign-extended into an unsigned one is
+    // reported unless the check is signed only.
+    return e->getKind() == Expr::ZExt ? mode == SignedOverflow
+                                      : (mode & UnsignedOverflow) != 0;
+  }
+  default:
+    return false;
+  }
+}
+
+ref<Expr> OverflowPredicates::truncation(const ref<Expr> &src, Expr::Width w,
+                                         OverflowSignedness mode) {
+  Expr::Width from = src->getWidth();
+  ref<Expr> condu, conds;
+  if (mode & UnsignedOverflow)
+    condu = UltExpr::create(
+        ConstantExpr::create(((uint64_t) 1 << w) - 1, from), src);
+  if (mode & SignedOverflow)
+    conds = NeExpr::create(
+        SExtExpr::create(ExtractExpr::create(src, 0, w), from), src);
+  if (condu.isNull())
+    return conds;
+  if (conds.isNull())
+    return condu;
+  return OrExpr::create(condu, conds);
+}
+
+ref<Expr> OverflowPredicates::signConversion(const ref<Expr> &src) {
+  return SltExpr::create(src, OverflowConstants::get(src->getWidth()).zero);
+}
+
+OverflowSignedness OverflowPredicates::parseSignedness(const std::string &s) {
+  if (s == "unsigned")
+    return UnsignedOverflow;
+  if (s == "signed")
+    return SignedOverflow;
+  return AnyOverflow;
+}
+
+const char *OverflowPredicates::getSignednessName(OverflowSignedness mode) {
+  switch (mode) {
+  case UnsignedOverflow: return "unsigned";
+  case SignedOverflow: return "signed";
+  default: return "both";
+  }
+}
+
+OverflowEncoding OverflowPredicates::getEncoding() {
+  return Encoding;
+}
+
+const char *OverflowPredicates::getEncodingName(OverflowEncoding encoding) {
+  switch (encoding) {
+  case SignBitEncoding: return "signbit";
+  case WidenEncoding: return "widen";
+  default: return "kint";
+  }
+}
+
+bool OverflowPredicates::isFolded(const ref<Expr> &predicate, bool &value) {
+  const ConstantExpr *ce = dyn_cast<ConstantExpr>(predicate);
+  if (!ce)
+    return false;
+
+  ++stats::overflowFoldedPredicates;
+  value = ce->isTrue();
+  return true;
+}
+
+namespace {
+  /// Turns an arithmetic or conversion node into its overflow predicate.
+  /// Only the kinds with overflow semantics have handlers; dispatch is
+  /// static so the other kinds cost nothing.
+  class OverflowPredicateGenerator
+    : public ExprIOStaticVisitor<OverflowPredicateGenerator> {
+    static Action changeTo(const ref<Expr> &cond) {
+      return cond.isNull() ? Action::skipChildren() : Action::changeTo(cond);
+    }
+
+    static ref<Expr> self(const Expr &e) {
+      return ref<Expr>(const_cast<Expr*>(&e));
+    }
+
+  public:
+    OverflowSignedness mode;
+    OverflowEncoding encoding;
+
+    OverflowPredicateGenerator(OverflowSignedness _mode,
+                               OverflowEncoding _encoding)
+      : mode(_mode), encoding(_encoding) {}
+
+    Action visitAdd(const AddExpr &e) {
+      return changeTo(OverflowPredicates::add(e.left, e.right, self(e), mode,
+                                              encoding));
+    }
+    Action visitSub(const SubExpr &e) {
+      return changeTo(OverflowPredicates::sub(e.left, e.right, self(e), mode,
+                                              encoding));
+    }
+    Action visitMul(const MulExpr &e) {
+      return changeTo(OverflowPredicates::mul(e.left, e.right, self(e), mode,
+                                              encoding));
+    }
+    Action visitSDiv(const SDivExpr &e) {
+      return changeTo(OverflowPredicates::sdiv(e.left, e.right, self(e),
+                                               encoding));
+    }
+    Action visitSRem(const SRemExpr &e) {
+      // A remainder has no quotient node, the sign-bit test divides.
+      ref<Expr> q;
+      if (encoding == SignBitEncoding)
+        q = SDivExpr::create(e.left, e.right);
+      return changeTo(OverflowPredicates::sdiv(e.left, e.right, q, encoding));
+    }
+    Action visitUDiv(const UDivExpr &e) {
+      return changeTo(OverflowPredicates::udiv(e.right));
+    }
+    Action visitURem(const URemExpr &e) {
+      return changeTo(OverflowPredicates::udiv(e.right));
+    }
+    Action visitShl(const ShlExpr &e) {
+      return changeTo(OverflowPredicates::shl(e.left, e.right, self(e), mode));
+    }
+    Action visitExtract(const ExtractExpr &e) {
+      if (!OverflowPredicates::checksConversion(self(e), mode))
+        return Action::skipChildren();
+      return changeTo(OverflowPredicates::truncation(e.expr, e.width, mode));
+    }
+    Action visitZExt(const ZExtExpr &e) {
+      if (!OverflowPredicates::checksConversion(self(e), mode))
+        return Action::skipChildren();
+      return changeTo(OverflowPredicates::signConversion(e.src));
+    }
+    Action visitSExt(const SExtExpr &e) {
+      if (!OverflowPredicates::checksConversion(self(e), mode))
+        return Action::skipChildren();
+      return changeTo(OverflowPredicates::signConversion(e.src));
+    }
+  };
+}
+
+ref<Expr> OverflowPredicates::build(const ref<Expr> &e,
+                                    OverflowSignedness mode) {
+  return build(e, mode, Encoding);
+}
+
+ref<Expr> OverflowPredicates::build(const ref<Expr> &e,
+                                    OverflowSignedness mode,
+                                    OverflowEncoding encoding) {
+  if (isa<ConstantExpr>(e) || !isSupportedWidth(e->getWidth()))
+    return ref<Expr>();
+
+  OverflowPredicateGenerator generator(mode, encoding);
+  ref<Expr> cond = generator.visitOutside(e);
+  if (cond.get() == e.get())
+    return ref<Expr>();
+  return cond;
+}
@@ -0,0 +1,513 @@
+//===-- OverflowRangeAnalysis.cpp -----------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/OverflowRangeAnalysis.h"
+
+#include "klee/Constraints.h"
+#include "klee/util/OverflowPredicates.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+  typedef __int128_t wide_int;
+  typedef __uint128_t wide_uint;
+
+  int64_t signExtend(uint64_t v, Expr::Width w) {
+    if (w >= 64)
+      return (int64_t) v;
+    uint64_t sign = (uint64_t) 1 << (w - 1);
+    return (v & sign) ? (int64_t) (v | ~BitRange::mask(w)) : (int64_t) v;
+  }
+
+  bool fitsSigned(wide_int v, Expr::Width w) {
+    wide_int hi = ((wide_int) 1 << (w - 1)) - 1;
+    return v >= -hi - 1 && v <= hi;
+  }
+}
+
+/***/
+
+BitRange BitRange::top(Expr::Width w) {
+  BitRange r;
+  r.knownZero = 0;
+  r.knownOne = 0;
+  r.umin = 0;
+  r.umax = mask(w);
+  return r;
+}
+
+BitRange BitRange::constant(uint64_t v, Expr::Width w) {
+  BitRange r;
+  v &= mask(w);
+  r.knownZero = ~v & mask(w);
+  r.knownOne = v;
+  r.umin = r.umax = v;
+  return r;
+}
+
+BitRange BitRange::interval(uint64_t lo, uint64_t hi, Expr::Width w) {
+  BitRange r = top(w);
+  r.umin = lo;
+  r.umax = hi;
+  r.normalize(w);
+  return r;
+}
+
+void BitRange::normalize(Expr::Width w) {
+  uint64_t m = mask(w);
+  knownZero &= m;
+  knownOne &= m;
+
+  uint64_t bitsMax = ~knownZero & m;
+  umin = std::max(umin, knownOne);
+  umax = std::min(umax, bitsMax);
+  if (umin > umax) {
+    // Contradicting facts (e.g. an infeasible seed): fall back to the bits.
+    umin = knownOne;
+    umax = bitsMax;
+  }
+
+  // Bits above the highest bit of umax are zero.
+  if (umax == 0) {
+    knownZero = m;
+  } else {
+    unsigned hb = 63 - __builtin_clzll(umax);
+    uint64_t below = hb == 63 ? ~(uint64_t) 0 : ((uint64_t) 2 << hb) - 1;
+    knownZero |= m & ~below;
+  }
+}
+
+int64_t BitRange::smin(Expr::Width w) const {
+  uint64_t smaxBits = mask(w) >> 1;
+  if (umax <= smaxBits || umin > smaxBits)
+    return signExtend(umin, w);
+  return signExtend(smaxBits + 1, w);
+}
+
+int64_t BitRange::smax(Expr::Width w) const {
+  uint64_t smaxBits = mask(w) >> 1;
+  if (umax <= smaxBits || umin > smaxBits)
+    return signExtend(umax, w);
+  return (int64_t) smaxBits;
+}
+
+/***/
+
+OverflowRangeAnalysis::OverflowRangeAnalysis(const ConstraintManager &constraints) {
+  for (ConstraintManager::const_iterator it = constraints.begin(),
+         ie = constraints.end(); it != ie; ++it)
+    addConstraint(*it);
+}
+
+void OverflowRangeAnalysis::seed(const ref<Expr> &e, uint64_t lo, uint64_t hi) {
+  if (!isSupported(e) || isa<ConstantExpr>(e))
+    return;
+
+  Expr::Width w = e->getWidth();
+  ExprHashMap<BitRange>::iterator it = seeds.find(e);
+  if (it == seeds.end()) {
+    seeds.insert(std::make_pair(e, BitRange::interval(lo, hi, w)));
+  } else {
+    it->second.umin = std::max(it->second.umin, lo);
+    it->second.umax = std::min(it->second.umax, hi);
+    it->second.normalize(w);
+  }
+  ranges.clear();
+}
+
+void OverflowRangeAnalysis::addConstraint(const ref<Expr> &constraint) {
+  ref<Expr> e = constraint;
+  bool negated = false;
+
+  // Constraints are canonical: (x != C) is (false == (C == x)), (x >= C) is
+  // (false == (x < C)), and so on.
+  if (const EqExpr *eq = dyn_cast<EqExpr>(e)) {
+    if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(eq->left)) {
+      if (ce->getWidth() == Expr::Bool && ce->isFalse()) {
+        negated = true;
+        e = eq->right;
+      } else if (isSupported(eq->right)) {
+        uint64_t v = ce->getZExtValue();
+        seed(eq->right, v, v);
+        return;
+      }
+    }
+  }
+
+  if (e->getNumKids() != 2)
+    return;
+
+  ref<Expr> a = e->getKid(0), b = e->getKid(1);
+  if (!isSupported(a))
+    return;
+
+  uint64_t m = BitRange::mask(a->getWidth());
+  const ConstantExpr *ca = dyn_cast<ConstantExpr>(a);
+  const ConstantExpr *cb = dyn_cast<ConstantExpr>(b);
+
+  switch (e->getKind()) {
+  case Expr::Ult:
+    if (cb) {
+      uint64_t c = cb->getZExtValue();
+      if (!negated && c > 0)
+        seed(a, 0, c - 1);          // a < C
+      else if (negated)
+        seed(a, c, m);              // a >= C
+    } else if (ca) {
+      uint64_t c = ca->getZExtValue();
+      if (!negated && c < m)
+        seed(b, c + 1, m);          // C < b
+      else if (negated)
+        seed(b, 0, c);              // b <= C
+    }
+    break;
+
+  case Expr::Ule:
+    if (cb) {
+      uint64_t c = cb->getZExtValue();
+      if (!negated)
+        seed(a, 0, c);              // a <= C
+      else if (c < m)
+        seed(a, c + 1, m);          // a > C
+    } else if (ca) {
+      uint64_t c = ca->getZExtValue();
+      if (!negated)
+        seed(b, c, m);              // C <= b
+      else if (c > 0)
+        seed(b, 0, c - 1);          // b < C
+    }
+    break;
+
+  case Expr::Eq:
+    if (negated && ca) {
+      uint64_t c = ca->getZExtValue();
+      if (c == 0)
+        seed(b, 1, m);              // b != 0
+      else if (c == m)
+        seed(b, 0, m - 1);          // b != -1
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+const BitRange &OverflowRangeAnalysis::get(const ref<Expr> &root) {
+  assert(isSupported(root) && "range analysis only handles widths <= 64");
+
+  ExprHashMap<BitRange>::iterator it = ranges.find(root);
+  if (it != ranges.end())
+    return it->second;
+
+  // Iterative post-order walk, deep expressions must not exhaust the stack.
+  std::vector< std::pair<ref<Expr>, bool> > stack;
+  stack.push_back(std::make_pair(root, false));
+  while (!stack.empty()) {
+    ref<Expr> e = stack.back().first;
+    if (ranges.count(e)) {
+      stack.pop_back();
+      continue;
+    }
+
+    if (!stack.back().second) {
+      stack.back().second = true;
+      if (!isa<ConstantExpr>(e) && !isa<ReadExpr>(e)) {
+        for (unsigned i = 0; i < e->getNumKids(); ++i) {
+          ref<Expr> kid = e->getKid(i);
+          if (isSupported(kid) && !ranges.count(kid))
+            stack.push_back(std::make_pair(kid, false));
+        }
+      }
+      continue;
+    }
+
+    stack.pop_back();
+    ranges.insert(std::make_pair(e, compute(e)));
+  }
+
+  return ranges.find(root)->second;
+}
+
+BitRange OverflowRangeAnalysis::compute(const ref<Expr> &e) {
+  Expr::Width w = e->getWidth();
+  uint64_t m = BitRange::mask(w);
+  BitRange r = BitRange::top(w);
+
+  // Ranges of the kids; a kid wider than 64 bits is unknown. get() does
+  // not descend into leaves, so the index of a read has no range.
+  BitRange k[3];
+  if (!isa<ConstantExpr>(e) && !isa<ReadExpr>(e)) {
+    for (unsigned i = 0; i < e->getNumKids() && i < 3; ++i) {
+      ref<Expr> kid = e->getKid(i);
+      k[i] = isSupported(kid) ? ranges.find(kid)->second
+                              : BitRange::top(64);
+    }
+  }
+
+  switch (e->getKind()) {
+  case Expr::Constant:
+    return BitRange::constant(cast<ConstantExpr>(e)->getZExtValue(), w);
+
+  case Expr::NotOptimized:
+    r = k[0];
+    break;
+
+  case Expr::Select:
+    r.knownZero = k[1].knownZero & k[2].knownZero;
+    r.knownOne = k[1].knownOne & k[2].knownOne;
+    r.umin = std::min(k[1].umin, k[2].umin);
+    r.umax = std::max(k[1].umax, k[2].umax);
+    break;
+
+  case Expr::Concat: {
+    Expr::Width rw = e->getKid(1)->getWidth();
+    r.knownZero = (k[0].knownZero << rw) | k[1].knownZero;
+    r.knownOne = (k[0].knownOne << rw) | k[1].knownOne;
+    r.umin = (k[0].umin << rw) | k[1].umin;
+    r.umax = (k[0].umax << rw) | k[1].umax;
+    break;
+  }
+
+  case Expr::Extract: {
+    const ExtractExpr *ee = cast<ExtractExpr>(e);
+    if (!isSupported(ee->expr))
+      break;
+    r.knownZero = k[0].knownZero >> ee->offset;
+    r.knownOne = k[0].knownOne >> ee->offset;
+    if (ee->offset == 0 && k[0].umax <= m) {
+      r.umin = k[0].umin;
+      r.umax = k[0].umax;
+    }
+    break;
+  }
+
+  case Expr::ZExt: {
+    Expr::Width sw = e->getKid(0)->getWidth();
+    r = k[0];
+    r.knownZero |= m & ~BitRange::mask(sw);
+    break;
+  }
+
+  case Expr::SExt: {
+    Expr::Width sw = e->getKid(0)->getWidth();
+    uint64_t high = m & ~BitRange::mask(sw);
+    uint64_t ssmax = BitRange::mask(sw) >> 1;
+    if (k[0].umax <= ssmax) {
+      r = k[0];
+      r.knownZero |= high;
+    } else if (k[0].umin > ssmax) {
+      r = k[0];
+      r.knownOne |= high;
+      r.umin |= high;
+      r.umax |= high;
+    }
+    break;
+  }
+
+  case Expr::Add:
+    if (k[0].umax <= m - k[1].umax) {
+      r.umin = k[0].umin + k[1].umin;
+      r.umax = k[0].umax + k[1].umax;
+    }
+    break;
+
+  case Expr::Sub:
+    if (k[0].umin >= k[1].umax) {
+      r.umin = k[0].umin - k[1].umax;
+      r.umax = k[0].umax - k[1].umin;
+    }
+    break;
+
+  case Expr::Mul:
+    if ((wide_uint) k[0].umax * k[1].umax <= m) {
+      r.umin = k[0].umin * k[1].umin;
+      r.umax = k[0].umax * k[1].umax;
+    }
+    break;
+
+  case Expr::SDiv:
+  case Expr::SRem:
+  case Expr::AShr:
+    // Same as the unsigned operation when both operands are non-negative.
+    if (k[0].umax > (m >> 1) || k[1].umax > (m >> 1))
+      break;
+    // fall through
+  case Expr::UDiv:
+  case Expr::URem:
+  case Expr::LShr:
+    if (e->getKind() == Expr::UDiv || e->getKind() == Expr::SDiv) {
+      if (k[1].umin > 0) {
+        r.umin = k[0].umin / k[1].umax;
+        r.umax = k[0].umax / k[1].umin;
+      }
+    } else if (e->getKind() == Expr::URem || e->getKind() == Expr::SRem) {
+      if (k[1].umin > 0)
+        r.umax = std::min(k[0].umax, k[1].umax - 1);
+    } else if (k[1].umin == k[1].umax && k[1].umin < w) {
+      uint64_t c = k[1].umin;
+      r.knownZero = (k[0].knownZero >> c) | (m & ~(m >> c));
+      r.knownOne = k[0].knownOne >> c;
+      r.umin = k[0].umin >> c;
+      r.umax = k[0].umax >> c;
+    } else {
+      r.umax = k[0].umax;
+    }
+    break;
+
+  case Expr::Shl:
+    if (k[1].umin == k[1].umax && k[1].umin < w) {
+      uint64_t c = k[1].umin;
+      r.knownZero = (k[0].knownZero << c) | (((uint64_t) 1 << c) - 1);
+      r.knownOne = k[0].knownOne << c;
+      if (k[0].umax <= (m >> c)) {
+        r.umin = k[0].umin << c;
+        r.umax = k[0].umax << c;
+      }
+    } else if (k[1].umin >= w) {
+      return BitRange::constant(0, w);
+    }
+    break;
+
+  case Expr::Not:
+    r.knownZero = k[0].knownOne;
+    r.knownOne = k[0].knownZero;
+    r.umin = m - k[0].umax;
+    r.umax = m - k[0].umin;
+    break;
+
+  case Expr::And:
+    r.knownZero = k[0].knownZero | k[1].knownZero;
+    r.knownOne = k[0].knownOne & k[1].knownOne;
+    r.umax = std::min(k[0].umax, k[1].umax);
+    break;
+
+  case Expr::Or:
+    r.knownZero = k[0].knownZero & k[1].knownZero;
+    r.knownOne = k[0].knownOne | k[1].knownOne;
+    r.umin = std::max(k[0].umin, k[1].umin);
+    break;
+
+  case Expr::Xor:
+    r.knownZero = (k[0].knownZero & k[1].knownZero) |
+                  (k[0].knownOne & k[1].knownOne);
+    r.knownOne = (k[0].knownZero & k[1].knownOne) |
+                 (k[0].knownOne & k[1].knownZero);
+    break;
+
+  default:
+    // Reads and comparisons: anything of their width.
+    break;
+  }
+
+  r.normalize(w);
+
+  ExprHashMap<BitRange>::iterator it = seeds.find(e);
+  if (it != seeds.end()) {
+    r.knownZero |= it->second.knownZero;
+    r.knownOne |= it->second.knownOne;
+    r.umin = std::max(r.umin, it->second.umin);
+    r.umax = std::min(r.umax, it->second.umax);
+    r.normalize(w);
+  }
+  return r;
+}
+
+bool OverflowRangeAnalysis::provesNoOverflow(const ref<Expr> &e,
+                                             OverflowSignedness mode) {
+  Expr::Width w = e->getWidth();
+  if (isa<ConstantExpr>(e) || !OverflowPredicates::isSupportedWidth(w))
+    return false;
+
+  if (OverflowPredicates::checksConversion(e, mode)) {
+    ref<Expr> src = e->getKid(0);
+    Expr::Width sw = src->getWidth();
+    BitRange s = get(src);
+    if (e->getKind() != Expr::Extract)
+      return s.umax <= (BitRange::mask(sw) >> 1);
+    // Truncation: the value must fit the narrower type.
+    return (!(mode & UnsignedOverflow) || s.umax <= BitRange::mask(w)) &&
+           (!(mode & SignedOverflow) ||
+            (fitsSigned(s.smin(sw), w) && fitsSigned(s.smax(sw), w)));
+  }
+  if (e->getNumKids() != 2)
+    return false;
+
+  switch (e->getKind()) {
+  case Expr::Add: case Expr::Sub: case Expr::Mul:
+  case Expr::UDiv: case Expr::SDiv: case Expr::URem: case Expr::SRem:
+  case Expr::Shl:
+    break;
+  default:
+    return false;
+  }
+
+  uint64_t m = BitRange::mask(w);
+  BitRange l = get(e->getKid(0));
+  BitRange r = get(e->getKid(1));
+  bool checkUnsigned = mode & UnsignedOverflow;
+  bool checkSigned = mode & SignedOverflow;
+
+  switch (e->getKind()) {
+  case Expr::Add:
+    return (!checkUnsigned || l.umax <= m - r.umax) &&
+           (!checkSigned ||
+            (fitsSigned((wide_int) l.smin(w) + r.smin(w), w) &&
+             fitsSigned((wide_int) l.smax(w) + r.smax(w), w)));
+
+  case Expr::Sub:
+    return (!checkUnsigned || l.umin >= r.umax) &&
+           (!checkSigned ||
+            (fitsSigned((wide_int) l.smin(w) - r.smax(w), w) &&
+             fitsSigned((wide_int) l.smax(w) - r.smin(w), w)));
+
+  case Expr::Mul: {
+    if (checkUnsigned && (wide_uint) l.umax * r.umax > m)
+      return false;
+    if (!checkSigned)
+      return true;
+    wide_int corners[4] = {
+      (wide_int) l.smin(w) * r.smin(w), (wide_int) l.smin(w) * r.smax(w),
+      (wide_int) l.smax(w) * r.smin(w), (wide_int) l.smax(w) * r.smax(w)
+    };
+    for (unsigned i = 0; i < 4; ++i)
+      if (!fitsSigned(corners[i], w))
+        return false;
+    return true;
+  }
+
+  case Expr::UDiv:
+  case Expr::URem:
+    return r.umin > 0;
+
+  case Expr::SDiv:
+  case Expr::SRem: {
+    uint64_t sminBits = (m >> 1) + 1;
+    bool lMayBeIntMin = l.umin <= sminBits && sminBits <= l.umax;
+    return r.umin > 0 && !(lMayBeIntMin && r.umax == m);
+  }
+
+  case Expr::Shl: {
+    if (r.umax >= w)
+      return false;
+    if (checkUnsigned && l.umax > (m >> r.umax))
+      return false;
+    // Shifting back arithmetically gives l iff l lies in
+    // [INT_MIN >> r, INT_MAX >> r].
+    wide_int hi = (((wide_int) 1 << (w - 1)) - 1) >> r.umax;
+    return !checkSigned || (l.smin(w) >= -hi - 1 && l.smax(w) <= hi);
+  }
+
+  default:
+    return false;
+  }
+}
@@ -0,0 +1,31 @@
+//===-- OverflowStats.cpp -------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/OverflowStats.h"
+
+using namespace klee;
+
+Statistic stats::overflowCacheLookups("OverflowCacheLookups", "OCl");
+Statistic stats::overflowCacheHits("OverflowCacheHits", "OCh");
+Statistic stats::overflowVerdictLookups("OverflowVerdictLookups", "OVl");
+Statistic stats::overflowVerdictHits("OverflowVerdictHits", "OVh");
+Statistic stats::overflowRangeDischarged("OverflowRangeDischarged", "ORd");
+Statistic stats::overflowFoldedPredicates("OverflowFoldedPredicates", "OFp");
+Statistic stats::sliceConstraintsIn("SliceConstraintsIn", "SCi");
+Statistic stats::sliceConstraintsKept("SliceConstraintsKept", "SCk");
+Statistic stats::overflowUnknown("OverflowUnknown", "OUk");
+Statistic stats::overflowSolverTimeUnsigned("OverflowSolverTimeUnsigned", "OTu");
+Statistic stats::overflowSolverTimeSigned("OverflowSolverTimeSigned", "OTs");
+Statistic stats::overflowSolverTimeBoth("OverflowSolverTimeBoth", "OTb");
+Statistic stats::overflowEncodingTimeKint("OverflowEncodingTimeKint", "OEk");
+Statistic stats::overflowEncodingTimeSignBit("OverflowEncodingTimeSignBit", "OEs");
+Statistic stats::overflowEncodingTimeWiden("OverflowEncodingTimeWiden", "OEw");
+Statistic stats::overflowEncodingMismatches("OverflowEncodingMismatches", "OEm");
+Statistic stats::visitorTraversalTime("VisitorTraversalTime", "VTt");
+Statistic stats::visitorStaticTraversalTime("VisitorStaticTraversalTime", "VTs");
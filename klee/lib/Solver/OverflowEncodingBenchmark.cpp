@@ -0,0 +1,136 @@
+//===-- OverflowEncodingBenchmark.cpp -------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/OverflowEncodingBenchmark.h"
+
+#include "klee/Constraints.h"
+#include "klee/OverflowStats.h"
+#include "klee/Solver.h"
+#include "klee/util/ExprCloner.h"
+#include "klee/util/ExprPPrinter.h"
+#include "klee/Internal/System/Time.h"
+
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+  llvm::cl::opt<bool>
+  EncodingBenchmark("overflow-encoding-benchmark",
+                    llvm::cl::desc("Solve every checked overflow node under "
+                                   "each predicate encoding and report the "
+                                   "solver time per encoding (on the "
+                                   "executor thread, without time limit)."),
+                    llvm::cl::init(false));
+
+  llvm::cl::opt<std::string>
+  QueryCorpus("overflow-query-corpus",
+              llvm::cl::desc("Append the overflow queries, under each "
+                             "encoding, to this KQuery file."),
+              llvm::cl::init(""));
+}
+
+static Statistic &encodingTimeStat(OverflowEncoding encoding) {
+  switch (encoding) {
+  case SignBitEncoding: return stats::overflowEncodingTimeSignBit;
+  case WidenEncoding: return stats::overflowEncodingTimeWiden;
+  default: return stats::overflowEncodingTimeKint;
+  }
+}
+
+static std::ostream *getCorpus() {
+  static std::ofstream *corpus = 0;
+  if (!corpus && !QueryCorpus.empty())
+    corpus = new std::ofstream(QueryCorpus.c_str(), std::ios::app);
+  return corpus;
+}
+
+bool OverflowEncodingBenchmark::isEnabled() {
+  return EncodingBenchmark || !QueryCorpus.empty();
+}
+
+void OverflowEncodingBenchmark::run(const ConstraintManager &constraints,
+                                    const ref<Expr> &node,
+                                    OverflowSignedness mode) {
+  std::ostream *corpus = getCorpus();
+  std::vector< ref<Expr> > built;
+  std::vector<OverflowEncoding> encodings;
+
+  for (unsigned i = 0; i < NumOverflowEncodings; ++i) {
+    OverflowEncoding encoding = (OverflowEncoding) i;
+    ref<Expr> predicate = OverflowPredicates::build(node, mode, encoding);
+    if (predicate.isNull() || isa<ConstantExpr>(predicate))
+      continue;
+    // Encodings sharing a form (e.g. kint and widen for Mul) build the same
+    // query; only the first one is measured.
+    if (std::find(built.begin(), built.end(), predicate) != built.end())
+      continue;
+    built.push_back(predicate);
+    encodings.push_back(encoding);
+
+    if (corpus) {
+      // The query is valid iff the node cannot overflow.
+      *corpus << "# " << OverflowPredicates::getEncodingName(encoding) << " "
+              << OverflowPredicates::getSignednessName(mode) << "\n";
+      ExprPPrinter::printQuery(*corpus, constraints,
+                               Expr::createIsZero(predicate));
+      corpus->flush();
+    }
+  }
+
+  if (!EncodingBenchmark || built.empty())
+    return;
+
+  // The encodings are timed on one solver instance, in this process, so
+  // that only the solver call is measured. The query is cloned for it:
+  // arrays cache the state of the first solver that saw them. The cloner
+  // is declared first so that it outlives the solver and its caches.
+  ExprCloner cloner;
+  std::vector< ref<Expr> > cloned;
+  for (ConstraintManager::const_iterator it = constraints.begin(),
+         ie = constraints.end(); it != ie; ++it)
+    cloned.push_back(cloner.clone(*it));
+  ConstraintManager clonedConstraints(cloned);
+  std::vector< ref<Expr> > predicates;
+  for (unsigned i = 0; i < built.size(); ++i)
+    predicates.push_back(cloner.clone(built[i]));
+  cloner.forgetOriginals();
+  STPSolver solver(false);
+
+  // The solver translates the constraints on their first use only: they
+  // are translated before timing, lest the first encoding pay for it.
+  std::vector<const Array*> objects;
+  std::vector< std::vector<unsigned char> > values;
+  solver.getInitialValues(Query(clonedConstraints,
+                                ConstantExpr::alloc(0, Expr::Bool)),
+                          objects, values);
+
+  bool answered = false, first = false;
+  for (unsigned i = 0; i < predicates.size(); ++i) {
+    bool mayBeTrue;
+    double start = util::getWallTime();
+    bool success =
+      solver.mayBeTrue(Query(clonedConstraints, predicates[i]), mayBeTrue);
+    encodingTimeStat(encodings[i]) +=
+      (uint64_t) ((util::getWallTime() - start) * 1000000);
+
+    if (!success)
+      continue;
+    if (!answered) {
+      answered = true;
+      first = mayBeTrue;
+    } else if (mayBeTrue != first) {
+      ++stats::overflowEncodingMismatches;
+    }
+  }
+}
@@ -0,0 +1,536 @@
+//===-- SolverPool.cpp ----------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/SolverPool.h"
+
+#include "klee/Constraints.h"
+#include "klee/Solver.h"
+#include "klee/util/ExprSerializer.h"
+#include "klee/util/ExprUtil.h"
+#include "klee/Internal/System/Time.h"
+
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+  llvm::cl::opt<unsigned>
+  OverflowSolverProcesses("overflow-solver-processes",
+                          llvm::cl::desc("Number of solver processes checking "
+                                         "overflow candidates and sinks "
+                                         "concurrently (0 solves them on the "
+                                         "executor thread)."),
+                          llvm::cl::init(0));
+
+  llvm::cl::opt<double>
+  OverflowQueryTimeout("overflow-query-timeout",
+                       llvm::cl::desc("Time limit in seconds of a single "
+                                      "overflow or sink query (0: none)."),
+                       llvm::cl::init(0));
+
+  llvm::cl::opt<double>
+  OverflowSiteBudget("overflow-site-budget",
+                     llvm::cl::desc("Solver time in seconds a single overflow "
+                                    "or sink site may use; the remaining "
+                                    "queries of the site are unknown (0: "
+                                    "none)."),
+                     llvm::cl::init(0));
+
+  llvm::cl::opt<double>
+  OverflowRetryTimeout("overflow-retry-timeout",
+                       llvm::cl::desc("Time limit in seconds of the low "
+                                      "priority retry of a query that ran out "
+                                      "of time (0: no retry)."),
+                       llvm::cl::init(0));
+}
+
+/// Writes to a socket. A peer that died fails the write rather than raise
+/// SIGPIPE.
+static bool writeAll(int fd, const void *data, size_t size) {
+  const char *p = static_cast<const char*>(data);
+  while (size) {
+    ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+static bool readAll(int fd, void *data, size_t size) {
+  char *p = static_cast<char*>(data);
+  while (size) {
+    ssize_t n = ::read(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+/// Result layout on the socket: verdict, number of arrays, then per array
+/// the length and bytes of its name and of its values.
+static bool writeResult(int fd, const SolverPool::Result &result) {
+  uint32_t verdict = result.verdict, count = result.model.size();
+  if (!writeAll(fd, &verdict, sizeof(verdict)) ||
+      !writeAll(fd, &count, sizeof(count)))
+    return false;
+  for (unsigned i = 0; i < count; ++i) {
+    const std::string &name = result.model[i].first;
+    const std::vector<unsigned char> &values = result.model[i].second;
+    uint32_t nameSize = name.size(), valuesSize = values.size();
+    if (!writeAll(fd, &nameSize, sizeof(nameSize)) ||
+        !writeAll(fd, name.data(), nameSize) ||
+        !writeAll(fd, &valuesSize, sizeof(valuesSize)) ||
+        (valuesSize && !writeAll(fd, &values[0], valuesSize)))
+      return false;
+  }
+  return true;
+}
+
+static bool readResult(int fd, SolverPool::Result &result) {
+  uint32_t verdict, count;
+  if (!readAll(fd, &verdict, sizeof(verdict)) ||
+      !readAll(fd, &count, sizeof(count)))
+    return false;
+  result.verdict = (SolverPool::Verdict) verdict;
+  result.model.resize(count);
+  for (unsigned i = 0; i < count; ++i) {
+    uint32_t nameSize, valuesSize;
+    if (!readAll(fd, &nameSize, sizeof(nameSize)))
+      return false;
+    std::string &name = result.model[i].first;
+    name.resize(nameSize);
+    if ((nameSize && !readAll(fd, &name[0], nameSize)) ||
+        !readAll(fd, &valuesSize, sizeof(valuesSize)))
+      return false;
+    std::vector<unsigned char> &values = result.model[i].second;
+    values.resize(valuesSize);
+    if (valuesSize && !readAll(fd, &values[0], valuesSize))
+      return false;
+  }
+  return true;
+}
+
+
+/// Message of a query: its size, the expressions (ExprSerializer), then
+/// whether a model is wanted, the number of constraints, the indices of
+/// the constraints and the index of the expression.
+static void encodeQuery(std::vector<unsigned char> &out,
+                        const ConstraintManager &constraints,
+                        const ref<Expr> &expr, bool wantModel) {
+  out.assign(sizeof(uint32_t), 0);
+  ExprSerializer writer(out);
+  std::vector<uint32_t> indices;
+  for (ConstraintManager::const_iterator it = constraints.begin(),
+         ie = constraints.end(); it != ie; ++it)
+    indices.push_back(writer.write(*it));
+  uint32_t index = writer.write(expr);
+  writer.finish();
+
+  writer.writeWord(wantModel);
+  writer.writeWord(indices.size());
+  for (unsigned i = 0; i < indices.size(); ++i)
+    writer.writeWord(indices[i]);
+  writer.writeWord(index);
+
+  uint32_t size = out.size() - sizeof(uint32_t);
+  memcpy(&out[0], &size, sizeof(size));
+}
+
+static bool decodeQuery(ExprDeserializer &reader,
+                        std::vector< ref<Expr> > &constraints,
+                        ref<Expr> &expr, bool &wantModel) {
+  uint32_t model, count, index;
+  if (!reader.read() || !reader.readWord(model) || !reader.readWord(count))
+    return false;
+  for (unsigned i = 0; i < count; ++i) {
+    if (!reader.readWord(index) || reader.get(index).isNull())
+      return false;
+    constraints.push_back(reader.get(index));
+  }
+  if (!reader.readWord(index))
+    return false;
+  expr = reader.get(index);
+  wantModel = model;
+  return !expr.isNull();
+}
+
+/// The parent's end of the sockets of all helpers, closed by every new
+/// helper: a helper holding the socket of another would keep it from
+/// seeing its peer go away.
+static std::set<int> &getHelperSockets() {
+  static std::set<int> sockets;
+  return sockets;
+}
+
+struct SolverPool::Job {
+  Ticket ticket;
+  double timeout;
+  /// The query, as sent to a helper (see encodeQuery()).
+  std::vector<unsigned char> message;
+};
+
+SolverPool *SolverPool::get() {
+  static SolverPool *pool =
+    OverflowSolverProcesses ? new SolverPool(OverflowSolverProcesses) : 0;
+  return pool;
+}
+
+double SolverPool::getQueryTimeout() { return OverflowQueryTimeout; }
+double SolverPool::getSiteBudget() { return OverflowSiteBudget; }
+double SolverPool::getRetryTimeout() { return OverflowRetryTimeout; }
+
+double SolverPool::getQueryLimit(double remaining) {
+  double timeout = OverflowQueryTimeout;
+  if (remaining > 0 && (timeout <= 0 || remaining < timeout))
+    return remaining;
+  return timeout;
+}
+
+SolverPool::SolverPool(unsigned numProcesses)
+  : helpers(numProcesses), nextTicket(1) {
+  // Helpers failing to start now are started again when needed.
+  for (unsigned i = 0; i < helpers.size(); ++i)
+    spawn(helpers[i]);
+}
+
+SolverPool::~SolverPool() {
+  for (unsigned i = 0; i < helpers.size(); ++i) {
+    stop(helpers[i]);
+    delete helpers[i].job;
+  }
+  for (std::deque<Job*>::iterator it = pending.begin(), ie = pending.end();
+       it != ie; ++it)
+    delete *it;
+  for (std::deque<Job*>::iterator it = lowPriority.begin(),
+         ie = lowPriority.end(); it != ie; ++it)
+    delete *it;
+}
+
+bool SolverPool::spawn(Helper &helper) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+    return false;
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+
+  if (pid == 0) {
+    close(fds[0]);
+    std::set<int> &sockets = getHelperSockets();
+    for (std::set<int>::iterator it = sockets.begin(), ie = sockets.end();
+         it != ie; ++it)
+      close(*it);
+    serve(fds[1]);
+    _exit(0);
+  }
+
+  close(fds[1]);
+  helper.pid = pid;
+  helper.fd = fds[0];
+  getHelperSockets().insert(fds[0]);
+  return true;
+}
+
+void SolverPool::stop(Helper &helper) {
+  if (!helper.pid)
+    return;
+
+  ::kill(helper.pid, SIGKILL);
+  while (waitpid(helper.pid, 0, 0) < 0 && errno == EINTR)
+    ;
+  close(helper.fd);
+  getHelperSockets().erase(helper.fd);
+  helper.pid = 0;
+  helper.fd = -1;
+}
+
+void SolverPool::serve(int fd) {
+  // The handlers inherited from the parent (QEMU's timers among them) must
+  // not run here, and the helper must not outlive the parent.
+  for (int sig = 1; sig < NSIG; ++sig)
+    ::signal(sig, SIG_DFL);
+  sigset_t none;
+  sigemptyset(&none);
+  sigprocmask(SIG_SETMASK, &none, 0);
+  prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+  // The helper is forked from the thread using the pool, between two of
+  // its queries, so the parent's solver is not halfway through one. The
+  // helper builds a solver chain of its own all the same, with the caches
+  // of the executor's, and keeps it and the arrays it saw across queries.
+  Solver *solver = createIndependentSolver(
+    createCachingSolver(createCexCachingSolver(new STPSolver(false))));
+  ExprDeserializer::ArrayTable arrays;
+  std::vector<unsigned char> message;
+  for (;;) {
+    uint32_t size;
+    if (!readAll(fd, &size, sizeof(size)))
+      break;
+    message.resize(size);
+    if (size && !readAll(fd, &message[0], size))
+      break;
+
+    Result result;
+    ExprDeserializer reader(arrays, message);
+    std::vector< ref<Expr> > constraints;
+    ref<Expr> expr;
+    bool wantModel;
+    if (decodeQuery(reader, constraints, expr, wantModel))
+      result = solve(solver, ConstraintManager(constraints), expr, wantModel);
+    if (!writeResult(fd, result))
+      break;
+  }
+}
+
+SolverPool::Result SolverPool::solve(Solver *solver,
+                                     const ConstraintManager &_constraints,
+                                     const ref<Expr> &expr, bool wantModel) {
+  Result result;
+  bool mayBeTrue;
+  if (!solver->mayBeTrue(Query(_constraints, expr), mayBeTrue))
+    return result;
+
+  result.verdict = mayBeTrue ? MayBeTrue : AlwaysFalse;
+  if (!mayBeTrue || !wantModel)
+    return result;
+
+  ConstraintManager constraints(_constraints);
+  constraints.addConstraint(expr);
+  std::vector<const Array*> objects;
+  for (ConstraintManager::const_iterator it = constraints.begin(),
+         ie = constraints.end(); it != ie; ++it)
+    findSymbolicObjects(*it, objects);
+  std::sort(objects.begin(), objects.end());
+  objects.erase(std::unique(objects.begin(), objects.end()), objects.end());
+
+  std::vector< std::vector<unsigned char> > values;
+  Query query(constraints, ConstantExpr::alloc(0, Expr::Bool));
+  if (solver->getInitialValues(query, objects, values)) {
+    for (unsigned i = 0; i < objects.size(); ++i)
+      result.model.push_back(std::make_pair(objects[i]->name, values[i]));
+  }
+  return result;
+}
+
+SolverPool::Result SolverPool::solveNow(const ConstraintManager &constraints,
+                                        const ref<Expr> &expr, double timeout,
+                                        bool wantModel) {
+  // A pool of its own, so that the query does not queue behind those of
+  // get(). Its helper is started once and kept, like its solver caches.
+  static SolverPool timed(1);
+  return timed.wait(timed.submit(constraints, expr, wantModel, timeout));
+}
+
+void SolverPool::complete(Helper &helper, const Result &result) {
+  finished.insert(std::make_pair(helper.job->ticket, result));
+  delete helper.job;
+  helper.job = 0;
+  helper.deadline = 0;
+}
+
+void SolverPool::dispatch() {
+  for (unsigned i = 0; i < helpers.size(); ++i) {
+    Helper &helper = helpers[i];
+    while (!helper.job && !(pending.empty() && lowPriority.empty())) {
+      std::deque<Job*> &queue = pending.empty() ? lowPriority : pending;
+      helper.job = queue.front();
+      queue.pop_front();
+
+      // A helper that died idle is replaced once before giving up on the
+      // job; the message is written whole, a helper reading it at once.
+      const std::vector<unsigned char> &message = helper.job->message;
+      bool sent = helper.pid && writeAll(helper.fd, &message[0], message.size());
+      if (!sent) {
+        stop(helper);
+        sent = spawn(helper) &&
+          writeAll(helper.fd, &message[0], message.size());
+      }
+      if (!sent) {
+        stop(helper);
+        complete(helper, Result());
+        continue;
+      }
+      if (helper.job->timeout > 0)
+        helper.deadline = util::getWallTime() + helper.job->timeout;
+    }
+  }
+}
+
+void SolverPool::progress(double timeout) {
+  dispatch();
+
+  std::vector<struct pollfd> fds;
+  std::vector<Helper*> busy;
+  double now = util::getWallTime();
+  for (unsigned i = 0; i < helpers.size(); ++i) {
+    Helper &helper = helpers[i];
+    if (!helper.job)
+      continue;
+    if (helper.deadline > 0) {
+      double left = std::max(helper.deadline - now, 0.0);
+      if (timeout < 0 || left < timeout)
+        timeout = left;
+    }
+    struct pollfd fd;
+    fd.fd = helper.fd;
+    fd.events = POLLIN;
+    fd.revents = 0;
+    fds.push_back(fd);
+    busy.push_back(&helper);
+  }
+  if (fds.empty())
+    return;
+
+  int ready = ::poll(&fds[0], fds.size(),
+                     timeout < 0 ? -1 : (int) std::ceil(timeout * 1000));
+
+  now = util::getWallTime();
+  for (unsigned i = 0; i < fds.size(); ++i) {
+    Helper &helper = *busy[i];
+    if (ready > 0 && fds[i].revents) {
+      // A helper writes its answer in one go: reading the rest of it does
+      // not wait for the solver. A helper that crashed fails the query.
+      Result result;
+      if (!readResult(helper.fd, result)) {
+        stop(helper);
+        result = Result();
+      }
+      complete(helper, result);
+    } else if (helper.deadline > 0 && now >= helper.deadline) {
+      // STP cannot be interrupted: the helper is killed, and restarted by
+      // dispatch() when there is work left.
+      stop(helper);
+      Result result;
+      result.verdict = TimedOut;
+      complete(helper, result);
+    }
+  }
+
+  dispatch();
+}
+
+SolverPool::Ticket SolverPool::submit(const ConstraintManager &constraints,
+                                      const ref<Expr> &expr, bool wantModel,
+                                      double timeout, bool lowPriority) {
+  Ticket ticket = nextTicket++;
+  Job *job = new Job();
+  job->ticket = ticket;
+  job->timeout = timeout;
+  encodeQuery(job->message, constraints, expr, wantModel);
+  (lowPriority ? this->lowPriority : pending).push_back(job);
+
+  // Starts the query if a helper is idle, and collects the answers ready.
+  progress(0);
+  return ticket;
+}
+
+bool SolverPool::isQueued(Ticket ticket) const {
+  for (unsigned i = 0; i < helpers.size(); ++i)
+    if (helpers[i].job && helpers[i].job->ticket == ticket)
+      return true;
+  for (std::deque<Job*>::const_iterator it = pending.begin(),
+         ie = pending.end(); it != ie; ++it)
+    if ((*it)->ticket == ticket)
+      return true;
+  for (std::deque<Job*>::const_iterator it = lowPriority.begin(),
+         ie = lowPriority.end(); it != ie; ++it)
+    if ((*it)->ticket == ticket)
+      return true;
+  return false;
+}
+
+SolverPool::Result SolverPool::wait(Ticket ticket, double timeout) {
+  double end = timeout > 0 ? util::getWallTime() + timeout : 0;
+  for (;;) {
+    std::map<Ticket, Result>::iterator it = finished.find(ticket);
+    if (it != finished.end()) {
+      Result result = it->second;
+      finished.erase(it);
+      return result;
+    }
+    if (!isQueued(ticket))
+      return Result();
+
+    double left = -1;
+    if (end > 0) {
+      left = end - util::getWallTime();
+      if (left <= 0) {
+        discard(ticket);
+        Result result;
+        result.verdict = TimedOut;
+        return result;
+      }
+    }
+    progress(left);
+  }
+}
+
+bool SolverPool::poll(Ticket ticket, Result &result) {
+  progress(0);
+  std::map<Ticket, Result>::iterator it = finished.find(ticket);
+  if (it == finished.end())
+    return false;
+  result = it->second;
+  finished.erase(it);
+  return true;
+}
+
+bool SolverPool::removePending(std::deque<Job*> &queue, Ticket ticket) {
+  for (std::deque<Job*>::iterator it = queue.begin(), ie = queue.end();
+       it != ie; ++it) {
+    if ((*it)->ticket == ticket) {
+      delete *it;
+      queue.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+void SolverPool::discard(Ticket ticket) {
+  if (finished.erase(ticket) ||
+      removePending(pending, ticket) || removePending(lowPriority, ticket))
+    return;
+
+  for (unsigned i = 0; i < helpers.size(); ++i) {
+    Helper &helper = helpers[i];
+    if (helper.job && helper.job->ticket == ticket) {
+      stop(helper);
+      delete helper.job;
+      helper.job = 0;
+      helper.deadline = 0;
+      return;
+    }
+  }
+}
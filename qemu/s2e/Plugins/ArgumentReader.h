@@ -0,0 +1,228 @@
+/*
+ * S2E Selective Symbolic Execution Framework
+ *
+ * Copyright (c) 2010, Dependable Systems Laboratory, EPFL
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Dependable Systems Laboratory, EPFL nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE DEPENDABLE SYSTEMS LABORATORY, EPFL BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Currently maintained by:
+ *    Vitaly Chipounov <vitaly.chipounov@epfl.ch>
+ *    Volodymyr Kuznetsov <vova.kuznetsov@epfl.ch>
+ *
+ * All contributors are listed in S2E-AUTHORS file.
+ *
+ */
+
+#ifndef S2E_PLUGINS_ARGUMENTREADER_H
+
+#define S2E_PLUGINS_ARGUMENTREADER_H
+
+#include <s2e/S2EExecutionState.h>
+
+#include <klee/Expr.h>
+
+#include <string>
+#include <vector>
+
+namespace s2e {
+namespace plugins {
+
+//在被拦截函数的第一条指令处按调用约定读取参数。栈上的参数（连同返回地址）一次读完，
+//读不出具体值（有符号字节）时才逐个参数读取，只为符号化的参数构造表达式。
+//寄存器编号按QEMU的regs[]：ECX=1、EDX=2、ESI=6、EDI=7、R8=8、R9=9
+class ArgumentReader
+{
+public:
+	//cdecl与stdcall在函数入口处的参数布局相同，区别只在于由谁清理栈
+	enum Convention { Cdecl, Stdcall, Fastcall, SysV64, Win64 };
+
+	ArgumentReader(S2EExecutionState *state, Convention convention, unsigned count):
+		m_convention(convention), m_slotSize(getSlotWidth(convention) / 8),
+		m_returnAddress(0), m_returnAddressValid(false), m_args(count)
+	{
+		uint64_t sp = state->getSp();
+
+		//栈上的槽位：0号是返回地址，参数从1号开始
+		unsigned slots = 1;
+		for (unsigned i = 0; i < count; ++i) {
+			int reg = getRegister(convention, i);
+			Argument &arg = m_args[i];
+			if (reg >= 0) {
+				arg.address = 0;
+				readRegister(state, reg, arg);
+			} else {
+				unsigned slot = getStackSlot(convention, i);
+				arg.address = sp + slot * m_slotSize;
+				if (slot + 1 > slots)
+					slots = slot + 1;
+			}
+		}
+
+		//一次读出整个栈帧
+		std::vector<uint8_t> frame(slots * m_slotSize);
+		bool bulk = state->readMemoryConcrete(sp, &frame[0], frame.size());
+		if (bulk) {
+			m_returnAddressValid = true;
+			m_returnAddress = slotValue(&frame[0]);
+		} else {
+			m_returnAddressValid = state->readMemoryConcrete(sp, &m_returnAddress, m_slotSize);
+		}
+
+		for (unsigned i = 0; i < count; ++i) {
+			Argument &arg = m_args[i];
+			if (!arg.address)
+				continue;
+			if (bulk) {
+				arg.concrete = true;
+				arg.value = slotValue(&frame[arg.address - sp]);
+			} else {
+				readStack(state, arg);
+			}
+		}
+	}
+
+	unsigned getCount() const { return m_args.size(); }
+	Convention getConvention() const { return m_convention; }
+
+	//参数的位宽
+	klee::Expr::Width getWidth() const { return m_slotSize * 8; }
+	static klee::Expr::Width getSlotWidth(Convention convention) {
+		return isWide(convention) ? klee::Expr::Int64 : klee::Expr::Int32;
+	}
+
+	//参数i能否读取（32位的目标上没有64位调用约定的寄存器参数）
+	bool isAvailable(unsigned i) const { return m_args[i].available; }
+
+	//参数i是否有具体值；没有时用getExpr取符号表达式
+	bool isConcrete(unsigned i) const { return m_args[i].concrete; }
+	uint64_t getValue(unsigned i) const { return m_args[i].value; }
+
+	//参数的表达式，具体值时为常量
+	klee::ref<klee::Expr> getExpr(unsigned i) const {
+		const Argument &arg = m_args[i];
+		if (arg.concrete)
+			return klee::ConstantExpr::create(arg.value, getWidth());
+		return arg.expr;
+	}
+
+	//参数在栈上的地址，寄存器参数为0
+	uint64_t getAddress(unsigned i) const { return m_args[i].address; }
+
+	bool getReturnAddress(uint64_t &address) const {
+		address = m_returnAddress;
+		return m_returnAddressValid;
+	}
+
+	//当前目标能否使用该调用约定：32位的目标上没有64位调用约定的寄存器和栈槽
+	static bool isSupported(Convention convention) {
+		return !isWide(convention) || sizeof(target_ulong) >= 8;
+	}
+
+	//配置文件中的名字："cdecl"/"stdcall"/"fastcall"/"sysv64"/"win64"
+	static Convention parseConvention(const std::string &name, Convention def) {
+		if (name == "cdecl") return Cdecl;
+		if (name == "stdcall") return Stdcall;
+		if (name == "fastcall") return Fastcall;
+		if (name == "sysv64") return SysV64;
+		if (name == "win64") return Win64;
+		return def;
+	}
+
+private:
+	struct Argument {
+		bool available;
+		bool concrete;
+		uint64_t value;
+		uint64_t address;
+		klee::ref<klee::Expr> expr;
+
+		Argument(): available(true), concrete(false), value(0), address(0) {}
+	};
+
+	Convention m_convention;
+	unsigned m_slotSize;
+	uint64_t m_returnAddress;
+	bool m_returnAddressValid;
+	std::vector<Argument> m_args;
+
+	static bool isWide(Convention convention) {
+		return convention == SysV64 || convention == Win64;
+	}
+
+	//参数i所在的寄存器，在栈上时返回-1
+	static int getRegister(Convention convention, unsigned i) {
+		static const int fastcall[] = { 1, 2 };
+		static const int sysv64[] = { 7, 6, 2, 1, 8, 9 };
+		static const int win64[] = { 1, 2, 8, 9 };
+		switch (convention) {
+		case Fastcall: return i < 2 ? fastcall[i] : -1;
+		case SysV64: return i < 6 ? sysv64[i] : -1;
+		case Win64: return i < 4 ? win64[i] : -1;
+		default: return -1;
+		}
+	}
+
+	//栈上参数i的槽位（以返回地址为0号）
+	static unsigned getStackSlot(Convention convention, unsigned i) {
+		switch (convention) {
+		case Fastcall: return i - 1;
+		case SysV64: return i - 5;
+		//Win64的前4个参数在栈上有预留的影子空间
+		default: return i + 1;
+		}
+	}
+
+	uint64_t slotValue(const uint8_t *p) const {
+		uint64_t value = 0;
+		for (unsigned i = 0; i < m_slotSize; ++i)
+			value |= (uint64_t) p[i] << (i * 8);
+		return value;
+	}
+
+	void readStack(S2EExecutionState *state, Argument &arg) const {
+		arg.value = 0;
+		arg.concrete = state->readMemoryConcrete(arg.address, &arg.value, m_slotSize);
+		if (!arg.concrete)
+			arg.expr = state->readMemory(arg.address, getWidth());
+	}
+
+	void readRegister(S2EExecutionState *state, int reg, Argument &arg) const {
+		//32位的目标上没有R8、R9，也没有64位的寄存器
+		if (reg >= CPU_NB_REGS || m_slotSize > sizeof(target_ulong)) {
+			arg.available = false;
+			arg.concrete = true;
+			return;
+		}
+		unsigned offset = CPU_OFFSET(regs[0]) + reg * sizeof(target_ulong);
+		arg.value = 0;
+		arg.concrete = state->readCpuRegisterConcrete(offset, &arg.value, m_slotSize);
+		if (!arg.concrete)
+			arg.expr = state->readCpuRegister(offset, getWidth());
+	}
+};
+
+} // namespace plugins
+} // namespace s2e
+
+#endif
@@ -54,11 +54,21 @@ extern "C" {
 #include <sstream>
 
 #include <list>
+#include <algorithm>
 
 #include <llvm/Support/TimeValue.h>
 #include <klee/Searcher.h>
 #include <klee/Solver.h>
 #include <klee/util/ExprIOVisitor.h>
+#include <klee/util/OverflowPredicates.h>
+#include <klee/util/OverflowPredicateCache.h>
+#include <klee/util/OverflowRangeAnalysis.h>
+#include <klee/util/ConstraintSlicer.h>
+#include <klee/SolverPool.h>
+#include <klee/OverflowEncodingBenchmark.h>
+#include <klee/util/ExprVisitorBenchmark.h>
+#include <klee/Internal/System/Time.h>
+#include <klee/OverflowStats.h>
 
 namespace s2e {
 namespace plugins {
@@ -73,6 +83,20 @@ void BaseInstructions::initialize()
     s2e()->getCorePlugin()->onCustomInstruction.connect(
             sigc::mem_fun(*this, &BaseInstructions::onCustomInstruction));
 
+    m_forkOnOverflow = s2e()->getConfig()->getBool(getConfigKey() + ".forkOnOverflow");
+    m_overflowForkResumeBelow = s2e()->getConfig()->getInt(getConfigKey() + ".overflowForkResumeBelow", 1);
+    if (m_forkOnOverflow) {
+        s2e()->getCorePlugin()->onStateKill.connect(
+                sigc::mem_fun(*this, &BaseInstructions::onStateKill));
+    }
+
+    if (ExprVisitorBenchmark::isEnabled())
+        ExprVisitorBenchmark::run(s2e()->getMessagesStream());
+
+    if ((SolverPool::get() && SolverPool::getRetryTimeout() > 0) || m_forkOnOverflow) {
+        s2e()->getCorePlugin()->onTimer.connect(
+                sigc::mem_fun(*this, &BaseInstructions::onTimer));
+    }
 }
 
 void BaseInstructions::makeSymbolic(S2EExecutionState *state, bool makeConcolic)
@@ -524,11 +548,36 @@ void BaseInstructions::concretize(S2EExecutionState *state, bool addConstraint)
  * 更新时间：20120703
  * 该函数主要是用来获取整数溢出的例子.
  * 目前功能：判断有没有发生整数溢出；
- * 需要改进的地方：当前这里还只是对其中32位的int类型的进行相关的检测；
+ * 变量的位宽由size给出（1、2、4、8字节），溢出条件由OverflowPredicates按位宽生成；
  *
  * */
 
-void BaseInstructions::getIntOverflowExample(S2EExecutionState *state)
+namespace {
+	//getIntOverflowExample中一个有溢出语义的结点及其求解状态
+	struct OverflowCandidate {
+		klee::ref<klee::Expr> node, predicate;
+		ConstraintManager constraints;	//与谓词相关的约束切片
+		OverflowPredicateCache::ConstraintKey constraintKey;
+		SolverPool::Ticket ticket;
+		bool resolved, isTrue;
+
+		OverflowCandidate(const klee::ref<klee::Expr> &_node, const klee::ref<klee::Expr> &_predicate)
+			: node(_node), predicate(_predicate), ticket(0),
+			  resolved(false), isTrue(false) {}
+	};
+}
+
+//各检查模式的求解时间（微秒），用来比较只检查一种语义时查询规模减小带来的收益
+static klee::Statistic &solverTimeStat(OverflowSignedness mode)
+{
+	switch (mode) {
+	case UnsignedOverflow: return stats::overflowSolverTimeUnsigned;
+	case SignedOverflow: return stats::overflowSolverTimeSigned;
+	default: return stats::overflowSolverTimeBoth;
+	}
+}
+
+void BaseInstructions::getIntOverflowExample(S2EExecutionState *state, OverflowSignedness mode)
 {
     	uint32_t address, size;
 	bool ok = true;
@@ -545,98 +594,305 @@ void BaseInstructions::getIntOverflowExample(S2EExecutionState *state)
         	return;
     	}
 
-    //需要在这里建立多种断言
-
-
-    //需要改进：当前，这里默认size的值就是Int32位的；
-    	//klee::ref<klee::Expr> symValue = state->readMemory(address, klee::Expr::Int16);
-		//test
-    	klee::ref<klee::Expr> symValue = state->readMemory(address, klee::Expr::Int32);
-/*	s2e()->getMessagesStream() << "---------param1 symbolic value : " << symValue << '\n';
-
-	klee::ref<klee::Expr> symValue_1 = klee::ZExtExpr::create(symValue, klee::Expr::Int64);
-	klee::ref<klee::Expr> symValue_2 = klee::SExtExpr::create(symValue, klee::Expr::Int64);
+	klee::Expr::Width width = size * 8;
+	if (!OverflowPredicates::isSupportedWidth(width)) {
+		s2e()->getWarningsStream(state)
+			<< "ERROR: getIntOverflowExample does not support variables of "
+			<< size << " bytes" << '\n';
+		return;
+	}
 
-	// klee::ref<klee::Expr> cond = klee::EqExpr::create(symValue, klee::ConstantExpr::create(0x8, symValue.get()->getWidth()));
-	klee::ref<klee::Expr> cond_1 = klee::UgtExpr::create(symValue_1, klee::ConstantExpr::create(0xfffffffe, klee::Expr::Int64));
-	klee::ref<klee::Expr> cond_2 = klee::SgtExpr::create(symValue_2, klee::ConstantExpr::create(0x7fffffff, klee::Expr::Int64));
-	//klee::ref<klee::Expr> cond = klee::EqExpr::create(klee::OrExpr::create(cond_1, cond_2), klee::ConstantExpr::create(0x1, klee::Expr::Bool));
-	s2e()->getMessagesStream() << "---------assert cond : " << cond_1 << '\n';
-*/
-	//打算这里对表达式进行重写
+	klee::ref<klee::Expr> symValue = state->readMemory(address, width);
+	if (symValue.isNull()) {
+		s2e()->getWarningsStream(state)
+			<< "ERROR: getIntOverflowExample could not read " << hexval(address) << '\n';
+		return;
+	}
 
-	s2e()->getMessagesStream() << "symValue:" << symValue << '\n';
+	s2e()->getMessagesStream() << "symValue:" << symValue
+							   << " (" << OverflowPredicates::getSignednessName(mode) << " overflow)" << '\n';
 
 	ExprIOVisitor e;
+	OverflowPredicateCache &cache = OverflowPredicateCache::get(mode);
+	OverflowRangeAnalysis ranges(state->constraints);
+	SolverPool *pool = SolverPool::get();
+	double timeout = SolverPool::getQueryTimeout();
+	double budget = SolverPool::getSiteBudget();
+	//预算按检查点累计，等待求解进程的时间也计入
+	double &spent = m_siteSolverTime[state->getPc()];
 	list < klee::ref<klee::Expr> > res;
 	klee::ref<klee::Expr> current,overflow;//current是当前处理的结点，overflow是重构后的条件。 by fwl
-	bool isTrue;
+	std::vector<OverflowCandidate> candidates;
 
 	res.push_back(symValue);
 
+	//第一遍：按广度优先顺序收集候选结点，不需要求解器就能确定的结点当场确定，其余的交给求解进程池
 	while (!res.empty()){
 		current = res.front();
 		s2e()->getMessagesStream() << "####current:" << current << '\n';
 		res.pop_front();
-		overflow = e.visitOutsideOp(current);
+		//区间/已知位分析能证明不溢出的结点不必构造谓词，也不必调用求解器
+		if (ranges.provesNoOverflow(current, mode)) {
+			++stats::overflowRangeDischarged;
+			overflow = current;
+		} else {
+			overflow = e.visitOutsideOp(current, mode);
+		}
 		
 		s2e()->getMessagesStream() << "####overflow:" << overflow << '\n';
 		
-		//s2e()->getMessagesStream() << "######overflowKind:" << overflow.get()->getKind() << '\n';
-		if ((overflow.get()->getKind() == klee::Expr::Read))/*||
-				(overflow.get()->getKind() == klee::Expr::ReadLSB)||
-				(overflow.get()->getKind() == klee::Expr::ReadMSB))*/
-			continue;
-		if (overflow.get()->getWidth() == klee::Expr::Bool){
-			if (!(s2e()->getExecutor()->getSolver()->mayBeTrue(klee::Query(state->constraints, overflow), isTrue))) {
-				s2e()->getWarningsStream() << "Failed to assert the condition!!" << '\n';
+		//没有溢出语义的结点（Read、Concat、比较等）原样返回，只需继续检查其子结点
+		if (overflow.get() != current.get() && overflow.get()->getWidth() == klee::Expr::Bool){
+			OverflowCandidate candidate(current, overflow);
+			//谓词被折叠为常量（如两个具体值相加）时直接得出结论，无需求解
+			if (OverflowPredicates::isFolded(overflow, candidate.isTrue)) {
+				candidate.resolved = true;
+				if (candidate.isTrue)
+					s2e()->getMessagesStream() << "####overflow predicate folded to true" << '\n';
+			} else {
+				//只保留与谓词（传递地）共享符号数组的约束，指纹也在切片上计算
+				candidate.constraints = ConstraintSlicer::get().slice(state->constraints, overflow);
+				candidate.constraintKey = OverflowPredicateCache::getConstraintKey(candidate.constraints);
+				OverflowPredicateCache::Verdict verdict = cache.getVerdict(current, candidate.constraintKey);
+				if (verdict != OverflowPredicateCache::Unknown) {
+					//同一约束集合下已经求解过的结点直接使用上一次的结果
+					candidate.resolved = true;
+					candidate.isTrue = verdict == OverflowPredicateCache::MayOverflow;
+				} else if (pool) {
+					candidate.ticket = pool->submit(candidate.constraints, overflow, false, timeout);
+				}
+			}
+			candidates.push_back(candidate);
+			//已经确定的溢出之后的结点不会再被报告，不必继续收集
+			if (candidate.resolved && candidate.isTrue)
+				break;
+		}
+		for (int i = 0;i != current->getNumKids(); ++i){
+			res.push_back(current->getKid(i));			
+		}
+	}
+
+	//第二遍：按收集顺序取结果，报告第一个可能溢出的结点，因此结果与进程数和完成顺序无关
+	const OverflowCandidate *finding = 0;
+	unsigned i = 0;
+	for (; i < candidates.size() && !finding; ++i) {
+		OverflowCandidate &candidate = candidates[i];
+		if (!candidate.resolved) {
+			//每个检查点的时间预算用完后，剩余的候选结点记为未知；单次查询和等待不超过剩余的预算
+			double start = klee::util::getWallTime();
+			double remaining = budget > 0 ? budget - spent : 0;
+			bool overBudget = budget > 0 && remaining <= 0;
+			double limit = SolverPool::getQueryLimit(remaining);
+			SolverPool::Verdict verdict;
+			if (overBudget) {
+				if (pool)
+					pool->discard(candidate.ticket);
+				verdict = SolverPool::TimedOut;
+			} else if (pool) {
+				verdict = pool->wait(candidate.ticket, remaining).verdict;
+			} else if (limit > 0) {
+				//执行器的求解器不能中断，有时间限制的查询交给常驻的求解进程
+				verdict = SolverPool::solveNow(candidate.constraints, candidate.predicate, limit).verdict;
+			} else if (s2e()->getExecutor()->getSolver()->mayBeTrue(klee::Query(candidate.constraints, candidate.predicate), candidate.isTrue)) {
+				verdict = candidate.isTrue ? SolverPool::MayBeTrue : SolverPool::AlwaysFalse;
+			} else {
+				verdict = SolverPool::Failed;
 			}
-			if (isTrue){
-				ConcreteInputs inputs;
-				ConcreteInputs::iterator it;
-
-				//首先，把原来的constraints保存一下；
-				ConstraintManager constraints_before(state->constraints);
-				ConstraintManager * p_constraints;
-				p_constraints = &state->constraints;
-
-				s2e()->getExecutor()->addConstraint(*state, overflow);//这里可以把约束条件添加进来么？
-
-				std::string constraint_str;
-
-				//s2e()->getExecutor()->getConstraintLog( *state, constraint_str, false);
-				//s2e()->getMessagesStream() << "constraint_str: " << constraint_str.c_str() << " : ";
-
-				s2e()->getExecutor()->getSymbolicSolution(*state, inputs);
-				s2e()->getMessagesStream()  << "---------malloc crash detected!" << '\n'
-											<< "---------input value : " << '\n';
-				for (it = inputs.begin(); it != inputs.end(); ++it) {
-					const VarValuePair &vp = *it;
-					s2e()->getMessagesStream() 	<< "---------" << vp.first << " : ";
-
-					for (unsigned i=0; i<vp.second.size(); ++i) {
-					
-						s2e()->getMessagesStream() << hexval((unsigned char) vp.second[i]) << " ";
-					}
-					s2e()->getMessagesStream() << '\n';
+			double elapsed = klee::util::getWallTime() - start;
+			spent += elapsed;
+			overBudget = budget > 0 && spent >= budget;
+			solverTimeStat(mode) += (uint64_t) (elapsed * 1000000);
+			//用每种谓词编码重新求解同一个结点，比较求解时间（-overflow-encoding-benchmark）
+			if (!overBudget && OverflowEncodingBenchmark::isEnabled())
+				OverflowEncodingBenchmark::run(candidate.constraints, candidate.node, mode);
+
+			candidate.isTrue = verdict == SolverPool::MayBeTrue;
+			if (verdict == SolverPool::MayBeTrue || verdict == SolverPool::AlwaysFalse) {
+				cache.setVerdict(candidate.node, candidate.constraintKey, candidate.isTrue ? OverflowPredicateCache::MayOverflow
+																						 : OverflowPredicateCache::CannotOverflow);
+			} else if (verdict == SolverPool::TimedOut) {
+				++stats::overflowUnknown;
+				s2e()->getWarningsStream() << "####overflow unknown (" << (overBudget ? "site budget exhausted" : "query timed out")
+										   << "): " << candidate.node << '\n';
+				if (pool && SolverPool::getRetryTimeout() > 0) {
+					PendingOverflowRetry retry;
+					retry.ticket = pool->submit(candidate.constraints, candidate.predicate, true,
+												SolverPool::getRetryTimeout(), true);
+					retry.node = candidate.node;
+					retry.predicate = candidate.predicate;
+					retry.constraintKey = candidate.constraintKey;
+					retry.mode = mode;
+					m_overflowRetries.push_back(retry);
 				}
+			} else {
+				s2e()->getWarningsStream() << "Failed to assert the condition!!" << '\n';
+			}
+			candidate.resolved = true;
+		}
+		if (candidate.isTrue)
+			finding = &candidate;
+	}
+	//已经报告了溢出，剩下的查询不再需要
+	for (; pool && i < candidates.size(); ++i) {
+		if (!candidates[i].resolved)
+			pool->discard(candidates[i].ticket);
+	}
+
+	if (finding) {
+		ConcreteInputs inputs;
+		ConcreteInputs::iterator it;
+
+		//首先，把原来的constraints保存一下；
+		ConstraintManager constraints_before(state->constraints);
+		ConstraintManager * p_constraints;
+		p_constraints = &state->constraints;
+
+		s2e()->getExecutor()->addConstraint(*state, finding->predicate);//这里可以把约束条件添加进来么？
+
+		std::string constraint_str;
 
-				//其次，等计算完了之后，再把相关的条件恢复过来，即可。
-				state->constraints = constraints_before;
+		//s2e()->getExecutor()->getConstraintLog( *state, constraint_str, false);
+		//s2e()->getMessagesStream() << "constraint_str: " << constraint_str.c_str() << " : ";
 
-				//这里还需要把原来的constraints清空，这里是不是应该删除阿？
-				p_constraints->empty();
-				//delete p_constraints; //error!
+		s2e()->getExecutor()->getSymbolicSolution(*state, inputs);
+		s2e()->getMessagesStream()  << "---------malloc crash detected!" << '\n'
+									<< "---------input value : " << '\n';
+		for (it = inputs.begin(); it != inputs.end(); ++it) {
+			const VarValuePair &vp = *it;
+			s2e()->getMessagesStream() 	<< "---------" << vp.first << " : ";
 
-				//s2e()->getExecutor()->getConstraintLog( *state, constraint_str, false);
-				//s2e()->getMessagesStream() << "state.constraints: " << constraint_str.c_str() << " : ";
-				break;	
+			for (unsigned i=0; i<vp.second.size(); ++i) {
+			
+				s2e()->getMessagesStream() << hexval((unsigned char) vp.second[i]) << " ";
 			}
+			s2e()->getMessagesStream() << '\n';
 		}
-		for (int i = 0;i != current->getNumKids(); ++i){
-			res.push_back(current->getKid(i));			
+
+		//其次，等计算完了之后，再把相关的条件恢复过来，即可。
+		state->constraints = constraints_before;
+
+		//分出一个满足溢出条件的状态，观察溢出的后果
+		if (m_forkOnOverflow)
+			forkOnOverflow(state, finding->predicate, "getIntOverflowExample", state->getPc());
+
+		//这里还需要把原来的constraints清空，这里是不是应该删除阿？
+		p_constraints->empty();
+		//delete p_constraints; //error!
+
+		//s2e()->getExecutor()->getConstraintLog( *state, constraint_str, false);
+		//s2e()->getMessagesStream() << "state.constraints: " << constraint_str.c_str() << " : ";
+	}
+}
+
+//取回低优先级重试的结果；重试的结论也写入判定缓存
+void BaseInstructions::reportOverflowRetries()
+{
+	SolverPool *pool = SolverPool::get();
+	std::list<PendingOverflowRetry>::iterator it = m_overflowRetries.begin();
+	while (it != m_overflowRetries.end()) {
+		OverflowPredicateCache &cache = OverflowPredicateCache::get(it->mode);
+		SolverPool::Result result;
+		if (!pool->poll(it->ticket, result)) {
+			++it;
+			continue;
 		}
+
+		if (result.verdict == SolverPool::MayBeTrue) {
+			cache.setVerdict(it->node, it->constraintKey, OverflowPredicateCache::MayOverflow);
+			s2e()->getMessagesStream() << "---------overflow confirmed on retry: " << it->node << '\n'
+									   << "---------input value : " << '\n';
+			for (unsigned i = 0; i < result.model.size(); ++i) {
+				const VarValuePair &vp = result.model[i];
+				s2e()->getMessagesStream() << "---------" << vp.first << " : ";
+				for (unsigned j = 0; j < vp.second.size(); ++j)
+					s2e()->getMessagesStream() << hexval((unsigned char) vp.second[j]) << " ";
+				s2e()->getMessagesStream() << '\n';
+			}
+		} else if (result.verdict == SolverPool::AlwaysFalse) {
+			cache.setVerdict(it->node, it->constraintKey, OverflowPredicateCache::CannotOverflow);
+			s2e()->getMessagesStream() << "---------overflow ruled out on retry: " << it->node << '\n';
+		} else {
+			s2e()->getWarningsStream() << "---------overflow still unknown after retry: " << it->node << '\n';
+		}
+		it = m_overflowRetries.erase(it);
+	}
+}
+
+void BaseInstructions::onTimer()
+{
+	if (SolverPool::get())
+		reportOverflowRetries();
+	if (m_forkOnOverflow)
+		resumeOverflowForks();
+}
+
+S2EExecutionState *BaseInstructions::forkOnOverflow(S2EExecutionState *state, const klee::ref<klee::Expr> &overflow,
+													const char *origin, uint64_t pc)
+{
+	if (!m_forkOnOverflow)
+		return NULL;
+
+	//具体执行模式下不能分支（插件中的分支只在符号执行模式下进行）
+	if (state->isRunningConcrete()) {
+		s2e()->getWarningsStream(state) << "####overflow at " << hexval(pc)
+										<< ": state is running concretely, overflow state not forked" << '
+';
+		return NULL;
 	}
+
+	//以不溢出为条件分支：原状态是条件成立的一支，继续主路径；新状态带着溢出条件
+	klee::Executor::StatePair sp = s2e()->getExecutor()->fork(*state, klee::Expr::createIsZero(overflow), false);
+	if (!sp.first || !sp.second) {
+		s2e()->getWarningsStream(state) << "####overflow at " << hexval(pc)
+										<< ": could not fork the overflow state" << '\n';
+		return NULL;
+	}
+
+	S2EExecutionState *forked = static_cast<S2EExecutionState*>(sp.second);
+	DECLARE_PLUGINSTATE(BaseInstructionsState, forked);
+	plgState->overflowOrigin = origin;
+	plgState->overflowPc = pc;
+
+	s2e()->getExecutor()->suspendState(forked);
+	m_suspendedOverflowForks.push_back(forked);
+	s2e()->getMessagesStream(state) << "####overflow state " << forked->getID() << " forked at " << hexval(pc)
+									<< " (" << origin << "), suspended with "
+									<< m_suspendedOverflowForks.size() << " others" << '\n';
+	return forked;
+}
+
+bool BaseInstructions::getOverflowOrigin(S2EExecutionState *state, std::string &origin, uint64_t &pc)
+{
+	DECLARE_PLUGINSTATE(BaseInstructionsState, state);
+	if (plgState->overflowOrigin.empty())
+		return false;
+	origin = plgState->overflowOrigin;
+	pc = plgState->overflowPc;
+	return true;
+}
+
+//按分出的先后顺序恢复挂起的溢出分支，每次只恢复一个
+void BaseInstructions::resumeOverflowForks()
+{
+	if (m_suspendedOverflowForks.empty())
+		return;
+
+	size_t active = s2e()->getExecutor()->getStatesCount() - m_suspendedOverflowForks.size();
+	if (active >= m_overflowForkResumeBelow)
+		return;
+
+	S2EExecutionState *state = m_suspendedOverflowForks.front();
+	m_suspendedOverflowForks.pop_front();
+	s2e()->getExecutor()->resumeState(state);
+	s2e()->getMessagesStream() << "####overflow state " << state->getID() << " resumed" << '\n';
+}
+
+void BaseInstructions::onStateKill(S2EExecutionState *state)
+{
+	std::deque<S2EExecutionState*>::iterator it =
+		std::find(m_suspendedOverflowForks.begin(), m_suspendedOverflowForks.end(), state);
+	if (it != m_suspendedOverflowForks.end())
+		m_suspendedOverflowForks.erase(it);
 }
 
 
@@ -867,7 +1123,9 @@ void BaseInstructions::handleBuiltInOps(S2EExecutionState* state, uint64_t opcod
             break;
 			
 		case 0x80: { /* s2e_get_int_overflow_example，用来计算出造成整数溢出的例子，需要知道该变量的名字 */
-        	getIntOverflowExample(state);
+			//第三个字节选择检查的语义：1为无符号，2为有符号，0（默认）两者都检查
+			uint64_t signedness = (opcode >> 16) & 3;
+        	getIntOverflowExample(state, signedness ? (OverflowSignedness) signedness : AnyOverflow);
             break;
         }
 
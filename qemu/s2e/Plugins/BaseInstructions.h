@@ -42,6 +42,14 @@
 #include <s2e/Plugins/CorePlugin.h>
 #include <s2e/S2EExecutionState.h>
 
+#include <klee/SolverPool.h>
+#include <klee/util/OverflowPredicates.h>
+#include <klee/util/OverflowPredicateCache.h>
+
+#include <deque>
+#include <list>
+#include <map>
+
 namespace s2e {
 namespace plugins {
 
@@ -49,7 +57,7 @@ class BaseInstructions : public Plugin
 {
     S2E_PLUGIN
 public:
-    BaseInstructions(S2E* s2e): Plugin(s2e) {}
+    BaseInstructions(S2E* s2e): Plugin(s2e), m_forkOnOverflow(false), m_overflowForkResumeBelow(1) {}
 
     void initialize();
    
@@ -59,6 +67,16 @@ public:
 	//wzy 添加
 	typedef std::pair<std::string, std::vector<unsigned char> > VarValuePair;
     typedef std::vector<VarValuePair> ConcreteInputs;
+
+	//溢出后果分支（配置项forkOnOverflow）：在满足overflow的条件下分出一个状态并打上标记，
+	//原状态加上不溢出的条件继续执行。分出的状态先挂起，活跃状态较少时再恢复，
+	//用来观察溢出的值之后是否到达memcpy、数组下标等位置，而不拖慢主路径的探索。
+	//返回分出的状态，未启用、状态处于具体执行模式或分支失败时返回NULL
+	S2EExecutionState *forkOnOverflow(S2EExecutionState *state, const klee::ref<klee::Expr> &overflow,
+									  const char *origin, uint64_t pc);
+	bool isForkOnOverflowEnabled() const { return m_forkOnOverflow; }
+	//state是否为溢出后果分支或由它分出的状态，是则返回溢出发生的位置
+	bool getOverflowOrigin(S2EExecutionState *state, std::string &origin, uint64_t &pc);
 	
 private:
     void onCustomInstruction(S2EExecutionState* state, 
@@ -73,11 +91,44 @@ private:
     void concretize(S2EExecutionState *state, bool addConstraint);
     void sleep(S2EExecutionState *state);
 	//wzy 添加
-	void getIntOverflowExample(S2EExecutionState *state);
+	void getIntOverflowExample(S2EExecutionState *state, klee::OverflowSignedness mode);
+	//每个检查点（调用getIntOverflowExample的pc）累计使用的求解时间（秒）
+	std::map<uint64_t, double> m_siteSolverTime;
+
+	//超时的溢出查询用放宽的超时在低优先级队列中重试，结果在定时器中取回
+	struct PendingOverflowRetry {
+		klee::SolverPool::Ticket ticket;
+		klee::ref<klee::Expr> node, predicate;
+		klee::OverflowPredicateCache::ConstraintKey constraintKey;
+		klee::OverflowSignedness mode;
+	};
+	std::list<PendingOverflowRetry> m_overflowRetries;
+	void reportOverflowRetries();
+	void onTimer();
+
+	bool m_forkOnOverflow;
+	//活跃（未挂起）状态数低于该值时恢复一个挂起的溢出分支
+	unsigned m_overflowForkResumeBelow;
+	std::deque<S2EExecutionState*> m_suspendedOverflowForks;
+	void resumeOverflowForks();
+	void onStateKill(S2EExecutionState *state);
 	//fwl 添加 
 	//bool intOverflow;
 };
 
+//BaseInstructions每个状态的数据，分支时随状态复制
+class BaseInstructionsState: public PluginState
+{
+public:
+    //溢出后果分支的来源，之后从它分出的状态也带着同样的来源
+    std::string overflowOrigin;
+    uint64_t overflowPc;
+
+    BaseInstructionsState() : overflowPc(0) {}
+    virtual BaseInstructionsState *clone() const { return new BaseInstructionsState(*this); }
+    static PluginState *factory(Plugin *p, S2EExecutionState *s) { return new BaseInstructionsState(); }
+};
+
 class BaseInstructionsPluginInvokerInterface {
 public:
     virtual void handleOpcodeInvocation(S2EExecutionState *state,
@@ -43,6 +43,7 @@ This plugin is used to implement vulnerability mining. It includes three parts:
 extern "C" {
 #include "config.h"
 #include "qemu-common.h"
+#include "exec-all.h"
 }
 
 
@@ -55,14 +56,25 @@ extern "C" {
 #include <s2e/S2EExecutionState.h>
 #include <s2e/S2EExecutor.h>
 #include <klee/Solver.h>
+#include <klee/util/OverflowPredicates.h>
+#include <klee/util/OverflowConstants.h>
+#include <klee/util/ConstraintSlicer.h>
+#include <klee/OverflowStats.h>
+#include <klee/Internal/System/Time.h>
 //#include <klee/Executor.h>
 
 //但是，头文件恰是在这里包含
 #include "../../monitor.h"
 #include "../../disas.h"
 
+#include <algorithm>
 #include <sstream>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using namespace std;
 
 using namespace s2e;
@@ -72,9 +84,72 @@ S2E_DEFINE_PLUGIN(VulMining, "Plugin for monitoring raw module events", "Interce
 
 std::string itoa(int value, int base);
 
-VulMining::~VulMining()
+//size参数的溢出条件：有符号语义为传入的int是负数（超出有符号数的范围），
+//无符号语义为size本身的计算（加、乘等）发生了回绕，只生成需要的那一部分
+static klee::ref<klee::Expr> sizeOverflowCondition(const klee::ref<klee::Expr> &size,
+												   klee::OverflowSignedness mode)
 {
+	klee::ref<klee::Expr> cond = klee::OverflowConstants::get(klee::Expr::Bool).zero;
+	if (mode & klee::SignedOverflow)
+		cond = klee::OverflowPredicates::exceedsSignedMax(size);
+	if (mode & klee::UnsignedOverflow) {
+		klee::ref<klee::Expr> wrap = klee::OverflowPredicates::build(size, klee::UnsignedOverflow);
+		if (!wrap.isNull())
+			cond = klee::OrExpr::create(cond, wrap);
+	}
+	return cond;
+}
+
+//memcpy的长度按有符号数比较，大于0x20即报告
+static const uint64_t MemcpyLengthBound = 0x20;
+
+//断言子句在具体值上的计算：值截断到width，有符号时按width位的符号位扩展
+static uint64_t truncateValue(uint64_t value, klee::Expr::Width width)
+{
+	return width >= 64 ? value : value & ((1ULL << width) - 1);
+}
+
+static int64_t signedValue(uint64_t value, klee::Expr::Width width)
+{
+	return width >= 64 ? (int64_t) value : (int64_t) (value << (64 - width)) >> (64 - width);
+}
 
+static uint64_t castValue(uint64_t value, klee::Expr::Width from, klee::Expr::Width to, bool isSigned)
+{
+	if (isSigned && to > from)
+		value = signedValue(value, from);
+	return truncateValue(value, to);
+}
+
+static klee::ref<klee::Expr> castArgument(const klee::ref<klee::Expr> &value, klee::Expr::Width to, bool isSigned)
+{
+	if (value->getWidth() == to)
+		return value;
+	if (value->getWidth() > to)
+		return klee::ExtractExpr::create(value, 0, to);
+	return isSigned ? klee::SExtExpr::create(value, to) : klee::ZExtExpr::create(value, to);
+}
+
+VulMining::~VulMining()
+{
+	//退出前把尚未完成的异步检查等完，避免丢失结果
+	reportSinkChecks(true);
+	for (unsigned i = 0; i < m_arithSiteMaps.size(); ++i) {
+		if (m_arithSiteMaps[i].mapping)
+			munmap(m_arithSiteMaps[i].mapping, m_arithSiteMaps[i].mappingSize);
+	}
+	if (m_inlineOverflow) {
+		s2e()->getMessagesStream() << "VulMining inline overflow checks: " << m_arithTranslations << " translated instructions, "
+								   << m_inlineConcreteHits << " concrete hits, "
+								   << m_inlineSymbolicHits << " symbolic hits ("
+								   << m_inlineDuplicateHits << " already checked)" << '\n';
+	}
+	for (std::map<std::string, SinkHits>::const_iterator it = m_sinkHits.begin(); it != m_sinkHits.end(); ++it) {
+		s2e()->getMessagesStream() << "VulMining sink " << it->first << ": "
+								   << it->second.concrete << " concrete hits ("
+								   << it->second.violated << " violated), "
+								   << it->second.symbolic << " symbolic hits" << '\n';
+	}
 }
 
 
@@ -108,6 +183,57 @@ void VulMining::initialize()
     m_onTranslateInstruction = s2e()->getCorePlugin()->onTranslateInstructionStart.connect(
         sigc::mem_fun(*this, &VulMining::onTranslateInstructionStart));
 
+	//每个断言检查的溢出语义：VulMining.signedness.<断言名> = "unsigned"/"signed"/"both"，默认为signed
+	for (AssertFunVector::iterator it = m_assertFunVector.begin(); it != m_assertFunVector.end(); ++it) {
+		std::string mode = s2e()->getConfig()->getString(getConfigKey() + ".signedness." + it->first, "signed");
+		m_sinkSignedness[it->first] = klee::OverflowPredicates::parseSignedness(mode);
+	}
+	//断言条件（配置项sinks），也会加入新的断言点
+	compileSinkPredicates();
+	initializeHeapTracking();
+
+	//4. 异步检查断言，需要求解进程池（-overflow-solver-processes）
+	m_asyncSinks = s2e()->getConfig()->getBool(getConfigKey() + ".asyncSinks");
+	if (m_asyncSinks && !klee::SolverPool::get()) {
+		s2e()->getWarningsStream() << "VulMining: asyncSinks requires -overflow-solver-processes > 0, "
+								   << "checking sinks synchronously" << '\n';
+		m_asyncSinks = false;
+	}
+	//异步检查的结果和超时查询的重试结果都在定时器中取回
+	if (m_asyncSinks || (klee::SolverPool::get() && klee::SolverPool::getRetryTimeout() > 0)) {
+		s2e()->getCorePlugin()->onTimer.connect(
+			sigc::mem_fun(*this, &VulMining::onTimer));
+	}
+
+	//溢出后果分支：assertMalloc发现溢出时分出一个带溢出条件的状态，而不是把条件加到当前状态上
+	m_baseInstructions = dynamic_cast<BaseInstructions*>(s2e()->getPlugin("BaseInstructions"));
+
+	//5. 翻译时插桩指定模块中的add/sub/imul/mul/shl指令：
+	//   inlineOverflowRanges = {起始地址, 大小, 起始地址, 大小, ...}
+	m_inlineOverflow = s2e()->getConfig()->getBool(getConfigKey() + ".inlineOverflow");
+	if (m_inlineOverflow) {
+		std::vector<int64_t> ranges = s2e()->getConfig()->getIntegerList(getConfigKey() + ".inlineOverflowRanges");
+		for (unsigned i = 0; i + 1 < ranges.size(); i += 2)
+			m_inlineRanges.push_back(std::make_pair((uint64_t) ranges[i], (uint64_t) (ranges[i] + ranges[i + 1])));
+		if (m_inlineRanges.empty()) {
+			s2e()->getWarningsStream() << "VulMining: inlineOverflow needs inlineOverflowRanges, disabled" << '\n';
+			m_inlineOverflow = false;
+		}
+	}
+	if (m_inlineOverflow) {
+		//x86指令本身不区分有无符号，默认两种语义都检查
+		m_inlineSignedness = klee::OverflowPredicates::parseSignedness(
+			s2e()->getConfig()->getString(getConfigKey() + ".inlineOverflowSignedness", "both"));
+		m_inlineDedup = s2e()->getConfig()->getBool(getConfigKey() + ".inlineOverflowDedup", true);
+		m_inlineDedupCapacity = s2e()->getConfig()->getInt(getConfigKey() + ".inlineOverflowDedupSize", 65536);
+		//算术指令表所在的目录，为空时翻译每条指令都要解码
+		m_arithSiteMapDir = s2e()->getConfig()->getString(getConfigKey() + ".arithSiteMapDir", "");
+		ArithSiteMap empty = { 0, 0, 0, 0, false, false, 0 };
+		m_arithSiteMaps.assign(m_inlineRanges.size(), empty);
+		m_onTranslateInstructionEnd = s2e()->getCorePlugin()->onTranslateInstructionEnd.connect(
+			sigc::mem_fun(*this, &VulMining::onTranslateArithmetic));
+	}
+
 }
 
 
@@ -331,6 +457,10 @@ void VulMining::onTranslateInstructionStart(ExecutionSignal *signal,
 	//4. terminate
 	terminateForking( signal, state, tb, pc);//////////////////////////////////////////////////
 
+	//5. heap, function returns
+	if (!m_pcHooks.empty())
+		connectPcHooks( signal, state, tb, pc);
+
 
 }
 
@@ -387,15 +517,21 @@ void VulMining::assertVulnerablePoints(ExecutionSignal *signal,
         const AssertFunPair &vp = *it;
         if ( pc == vp.second)
         {
-        	if (strstr("VulMining::assertMemcpy", vp.first.c_str()))
+        	//配置文件新增的断言优先，断言名按全名比较
+        	std::map<uint64_t, std::string>::const_iterator sit = m_configuredSinks.find(pc);
+        	if (sit != m_configuredSinks.end() && sit->second == vp.first)
+        	{
+        		signal->connect(sigc::mem_fun(*this, &VulMining::assertConfiguredSink));
+        	}
+        	else if (vp.first == "assertMemcpy")
         	{
         		signal->connect(sigc::mem_fun(*this, &VulMining::assertMemcpy));
         	}
-        	else if( strstr("VulMining::assertMalloc", vp.first.c_str()))
+        	else if (vp.first == "assertMalloc")
         	{
         		signal->connect(sigc::mem_fun(*this, &VulMining::assertMalloc));
         	}
-        	else if( strstr("VulMining::assert_string_alloc", vp.first.c_str()))
+        	else if (vp.first == "assert_string_alloc")
         	{
         	    signal->connect(sigc::mem_fun(*this, &VulMining::assert_string_alloc));
         	}
@@ -441,12 +577,13 @@ void VulMining::setReceiveInputsSymbolicVar(S2EExecutionState *state, uint64_t p
 	sp = state->getSp();
 	address =sp + 0xc;
 
+	ArgumentReader args(state, getConvention("recv", ArgumentReader::Stdcall), 3);
 	//recv的第一个参数，该值是socket
-	state->readMemoryConcrete(sp + 0x4, &param1_s, sizeof(uint32_t));
+	param1_s = args.getValue(0);
     //recv的第二个参数，该值存放buf的初始地址
-	state->readMemoryConcrete(sp + 0x8, &param2_buf_addr, sizeof(uint32_t));
+	param2_buf_addr = args.getValue(1);
 	//recv的第三个参数，该值存放的len
-    state->readMemoryConcrete(sp + 0xc, &param3_recv_len, sizeof(uint32_t));
+    param3_recv_len = args.getValue(2);
 
 	s2e()->getMessagesStream() << "receive is called " << hexval(pc) <<'\n';
 
@@ -548,11 +685,12 @@ void VulMining::setWSAReceiveInputsSymbolicVar(S2EExecutionState *state, uint64_
 	sp = state->getSp();
 	address =sp + 0xc;
 
-	state->readMemoryConcrete(sp + 0x4, &param1, sizeof(uint32_t));//param1的大小是4，这个值用来干什么的呢？
-    state->readMemoryConcrete(sp + 0x8, &param2, sizeof(uint32_t));//param2存放的是__WSABUF中的数值
-    state->readMemoryConcrete(sp + 0x0c, &dwBufferCount, sizeof(uint32_t));//dwBufferCount存放的是WSABUF的个数
-    state->readMemoryConcrete(sp + 0x10, &lpNumberofBytesRecvd, sizeof(uint32_t));//dwBufferCount存放的是WSABUF的个数
-    state->readMemoryConcrete(sp + 0x10, &NumberofBytesRecvd, sizeof(uint32_t));
+	ArgumentReader args(state, getConvention("WSARecv", ArgumentReader::Stdcall), 4);
+	param1 = args.getValue(0);//param1的大小是4，这个值用来干什么的呢？
+    param2 = args.getValue(1);//param2存放的是__WSABUF中的数值
+    dwBufferCount = args.getValue(2);//dwBufferCount存放的是WSABUF的个数
+    lpNumberofBytesRecvd = args.getValue(3);//dwBufferCount存放的是WSABUF的个数
+    NumberofBytesRecvd = args.getValue(3);
 
 
     typedef struct __WSABUF{
@@ -702,6 +840,14 @@ void VulMining::assertMemcpy(S2EExecutionState *state, uint64_t pc)
 	uint64_t value = 0, address = 0, sp = 0;
 	uint64_t param1 = 0, param2 = 0, param3 = 0;
 
+	const SinkPredicate &predicate = m_sinkPredicates["assertMemcpy"];
+	ArgumentReader args(state, predicate.convention, std::max(3u, predicate.argCount));
+	if (m_trackHeap)
+		checkHeapBounds(state, "assertMemcpy", pc, args, 0, 2, 1);
+	klee::ref<klee::Expr> cond;
+	if (evaluateSink(state, "assertMemcpy", pc, args, predicate, cond) != SinkSymbolic)
+		return;
+
 	//生成一个FILE结构
 	FILE *m_logFile;
 	m_logFile = fopen("/home/wzy/disas.txt", "w+");
@@ -709,12 +855,12 @@ void VulMining::assertMemcpy(S2EExecutionState *state, uint64_t pc)
 	fclose(m_logFile);
 
 	sp = state->getSp();
-	address =sp + 0xc;
 
-	state->readMemoryConcrete(sp + 0x4, &param1, sizeof(uint32_t));
-    state->readMemoryConcrete(sp + 0x8, &param2, sizeof(uint32_t));
-    state->readMemoryConcrete(sp + 0xc, &param3, sizeof(uint32_t));
-    state->readMemoryConcrete(address, &value, sizeof(uint32_t));
+	address = args.getAddress(2);
+	param1 = args.getValue(0);
+    param2 = args.getValue(1);
+    param3 = args.getValue(2);
+    value = param3;
 
 	s2e()->getMessagesStream() << "assertMemcpy pc " << hexval(pc) <<'\n'
 							   << "---------sp     : " << hexval(sp) <<'\n'
@@ -724,22 +870,23 @@ void VulMining::assertMemcpy(S2EExecutionState *state, uint64_t pc)
 							   << "---------param3 address : " << hexval(address) <<'\n'
 							   << "---------param3 value   : " << hexval(value) <<'\n';
 
-    klee::ref<klee::Expr> symValue = state->readMemory(address, klee::Expr::Int32);//既然是符号化的值，这里如何把符号化的表达式输出来呢？
+    klee::ref<klee::Expr> symValue = args.getExpr(2);//既然是符号化的值，这里如何把符号化的表达式输出来呢？
 	s2e()->getMessagesStream() << "---------param3 symbolic value : " << symValue <<'\n';
 
-	klee::ref<klee::Expr> cond = klee::SgtExpr::create(symValue, klee::ConstantExpr::create(0x20, symValue.get()->getWidth()));
 	s2e()->getMessagesStream() << "---------assert cond : " << cond <<'\n';
 
+	if (m_asyncSinks && submitSinkCheck(state, "assertMemcpy", pc, cond))
+		return;
+
 	bool isTrue;
-	if (!(s2e()->getExecutor()->getSolver()->mayBeTrue(klee::Query(state->constraints, cond), isTrue))) {
-		s2e()->getMessagesStream() << "failed to assert the condition" <<'\n';
+	if (!solveSinkCondition(state, "assertMemcpy", pc, cond, isTrue))
 		return;
-    }
 	if (isTrue) {
 		ConcreteInputs inputs;
 		ConcreteInputs::iterator it;
 
 		s2e()->getExecutor()->getSymbolicSolution(*state, inputs);
+		noteOverflowFork(state, "assertMemcpy");
 		s2e()->getMessagesStream() << "---------memcpy crash detected!" <<'\n'
 								   << "---------input value : " <<'\n';
 	    for (it = inputs.begin(); it != inputs.end(); ++it) {
@@ -759,24 +906,23 @@ void VulMining::assertMemcpy(S2EExecutionState *state, uint64_t pc)
 void VulMining::assertMalloc(S2EExecutionState *state, uint64_t pc)
 {
 	uint64_t sp, param1, param1Addr,retaddr;
-	bool result;
 
 	sp = state->getSp();
-	param1Addr = sp + 0x4;
-	state->readMemoryConcrete(sp, &retaddr, sizeof(uint32_t));
+	const SinkPredicate &predicate = m_sinkPredicates["assertMalloc"];
+	ArgumentReader args(state, predicate.convention, std::max(1u, predicate.argCount));
+	param1Addr = args.getAddress(0);
+	args.getReturnAddress(retaddr);
 	//s2e()->getWarningsStream() << " the address of call malloc is:   " << hexval(retaddr)<<std::endl;
 	//s2e()->getWarningsStream() << "assertMalloc is called, the running pc: " << hexval(pc)<<std::endl;
 
-
-	result = state->readMemoryConcrete(param1Addr, &param1, sizeof(uint32_t));
+	param1 = args.getValue(0);
 
 	//s2e()->getWarningsStream() << " the param of malloc is:   " <<hexval(param1)<<std::endl;
 
-	//如果成功，表示这里是具体值，还不是符号化的值，则不为外部控制，则直接返回
-	if( result )
-	{
+	//具体值直接计算，不为外部控制，不需要求解
+	klee::ref<klee::Expr> cond_1;
+	if (evaluateSink(state, "assertMalloc", pc, args, predicate, cond_1) != SinkSymbolic)
 		return;
-	}
 
 	s2e()->getMessagesStream() << "assertMalloc is called " <<'\n';
 
@@ -785,30 +931,33 @@ void VulMining::assertMalloc(S2EExecutionState *state, uint64_t pc)
 							   << "---------param1 : " << hexval(param1) <<'\n'
 							   << "---------param1 address : " << hexval(param1Addr) <<'\n';
 
-    klee::ref<klee::Expr> symValue = state->readMemory(param1Addr, klee::Expr::Int32);
+    klee::ref<klee::Expr> symValue = args.getExpr(0);
 	s2e()->getMessagesStream() << "---------param1 symbolic value : " << symValue <<'\n';
 
-	klee::ref<klee::Expr> symValue_1 = klee::ZExtExpr::create(symValue, klee::Expr::Int64);
-	klee::ref<klee::Expr> symValue_2 = klee::SExtExpr::create(symValue, klee::Expr::Int64);
-
-	// klee::ref<klee::Expr> cond = klee::EqExpr::create(symValue, klee::ConstantExpr::create(0x8, symValue.get()->getWidth()));
-	klee::ref<klee::Expr> cond_1 = klee::UgtExpr::create(symValue_1, klee::ConstantExpr::create(0xffffffff, klee::Expr::Int64));
-	klee::ref<klee::Expr> cond_2 = klee::SgtExpr::create(symValue_2, klee::ConstantExpr::create(0x7fffffff, klee::Expr::Int64));
-	//klee::ref<klee::Expr> cond = klee::EqExpr::create(klee::OrExpr::create(cond_1, cond_2), klee::ConstantExpr::create(0x1, klee::Expr::Bool));
+	//size_t的值超出了有符号数的范围，即调用者传入的int为负数或者计算时发生了溢出
 	s2e()->getMessagesStream() << "---------assert cond : " << cond_1 <<'\n';
 
+	if (m_asyncSinks && submitSinkCheck(state, "assertMalloc", pc, cond_1))
+		return;
+
 	bool isTrue;
-	if (!(s2e()->getExecutor()->getSolver()->mayBeTrue(klee::Query(state->constraints, cond_1), isTrue))) {
-		s2e()->getMessagesStream() << "Failed to assert the condition" <<'\n';
+	if (!solveSinkCondition(state, "assertMalloc", pc, cond_1, isTrue))
 		return;
-    }
 	if (isTrue) {
 		ConcreteInputs inputs;
 		ConcreteInputs::iterator it;
 
+		bool fork = m_baseInstructions && m_baseInstructions->isForkOnOverflowEnabled();
+		klee::ConstraintManager constraintsBefore(state->constraints);
 		s2e()->getExecutor()->addConstraint(*state, cond_1);
 
 		s2e()->getExecutor()->getSymbolicSolution(*state, inputs);
+		//分支模式下当前状态不保留溢出条件，由分出的状态带着溢出条件继续执行
+		if (fork) {
+			state->constraints = constraintsBefore;
+			m_baseInstructions->forkOnOverflow(state, cond_1, "assertMalloc", pc);
+		}
+		noteOverflowFork(state, "assertMalloc");
 		s2e()->getMessagesStream() << "---------malloc crash detected!" <<'\n'
 								   << "---------input value : " <<'\n';
 	    for (it = inputs.begin(); it != inputs.end(); ++it) {
@@ -825,22 +974,638 @@ void VulMining::assertMalloc(S2EExecutionState *state, uint64_t pc)
 
 
 
+//断言的统一入口：参数都是具体值的子句在宿主上直接计算，其余子句才实例化成条件，分别计数
+VulMining::SinkVerdict VulMining::evaluateSink(S2EExecutionState *state, const char *sink, uint64_t pc,
+											   const ArgumentReader &args, const SinkPredicate &predicate,
+											   klee::ref<klee::Expr> &cond)
+{
+	SinkHits &hits = m_sinkHits[sink];
+	bool symbolic = false;
+	std::vector<SinkClause>::const_iterator it;
+	for (it = predicate.clauses.begin(); it != predicate.clauses.end(); ++it) {
+		if (!args.isConcrete(it->arg) || (it->boundArg >= 0 && !args.isConcrete(it->boundArg))) {
+			symbolic = true;
+			continue;
+		}
+		if (evaluateSinkClause(*it, args)) {
+			++hits.concrete;
+			++hits.violated;
+			s2e()->getMessagesStream(state) << "---------" << sink << " at " << hexval(pc)
+											<< " violated by the concrete argument "
+											<< hexval(args.getValue(it->arg)) << '\n';
+			return SinkViolated;
+		}
+	}
+	if (!symbolic) {
+		++hits.concrete;
+		return SinkSafe;
+	}
+
+	++hits.symbolic;
+	cond = klee::ref<klee::Expr>();
+	for (it = predicate.clauses.begin(); it != predicate.clauses.end(); ++it) {
+		if (args.isConcrete(it->arg) && (it->boundArg < 0 || args.isConcrete(it->boundArg)))
+			continue;
+		klee::ref<klee::Expr> clause = instantiateSinkClause(*it, args);
+		cond = cond.isNull() ? clause : klee::OrExpr::create(cond, clause);
+	}
+	return SinkSymbolic;
+}
+
+VulMining::SinkClause VulMining::makeSinkClause(unsigned arg, klee::Expr::Width width, klee::OverflowSignedness mode,
+												SinkCompare compare, int boundArg, uint64_t bound)
+{
+	SinkClause clause;
+	clause.arg = arg;
+	clause.width = width;
+	clause.mode = mode;
+	clause.compare = compare;
+	clause.boundArg = boundArg;
+	clause.bound = truncateValue(bound, width);
+	clause.boundExpr = klee::ConstantExpr::create(clause.bound, width);
+	return clause;
+}
+
+bool VulMining::compileSinkClause(const std::string &key, klee::Expr::Width argWidth,
+								  klee::OverflowSignedness mode, SinkClause &clause)
+{
+	ConfigFile *cfg = s2e()->getConfig();
+	bool ok = false;
+	int64_t arg = cfg->getInt(key + ".arg", 0, &ok);
+	int64_t width = cfg->getInt(key + ".width", argWidth);
+	if (!ok || arg < 0 || width < 1 || width > 64) {
+		s2e()->getWarningsStream() << "VulMining: " << key << " needs an argument index and a width of 1-64 bits" << '\n';
+		return false;
+	}
+
+	std::string signedness = cfg->getString(key + ".signedness", "");
+	if (!signedness.empty())
+		mode = klee::OverflowPredicates::parseSignedness(signedness);
+
+	static const char *const names[] = { "overflow", "==", "!=", "<", "<=", ">", ">=" };
+	std::string name = cfg->getString(key + ".compare", "overflow");
+	unsigned compare = 0;
+	while (compare < sizeof(names) / sizeof(names[0]) && name != names[compare])
+		++compare;
+	if (compare == sizeof(names) / sizeof(names[0])) {
+		s2e()->getWarningsStream() << "VulMining: " << key << ": unknown comparison " << name << '\n';
+		return false;
+	}
+
+	int boundArg = cfg->getInt(key + ".boundArg", -1);
+	uint64_t bound = cfg->getInt(boundArg < 0 ? key + ".bound" : key + ".boundOffset", 0);
+	clause = makeSinkClause(arg, width, mode, (SinkCompare) compare, boundArg, bound);
+	return true;
+}
+
+//内置断言的默认条件，再用配置文件中的sinks覆盖或新增。
+//内置断言的调用约定也可以用sinks.<断言名>.convention指定，默认条件按它的参数位宽构造
+void VulMining::compileSinkPredicates()
+{
+	ConfigFile *cfg = s2e()->getConfig();
+	std::string sinksKey = getConfigKey() + ".sinks";
+
+	SinkPredicate &memcpySink = m_sinkPredicates["assertMemcpy"];
+	memcpySink.convention = readConvention(sinksKey + ".assertMemcpy.convention",
+										   getConvention("memcpy", ArgumentReader::Cdecl));
+	memcpySink.clauses.push_back(makeSinkClause(2, ArgumentReader::getSlotWidth(memcpySink.convention),
+												klee::SignedOverflow, SinkGt, -1, MemcpyLengthBound));
+
+	//size_t的值超出了有符号数的范围，即调用者传入的int为负数或者计算时发生了溢出
+	SinkPredicate &mallocSink = m_sinkPredicates["assertMalloc"];
+	mallocSink.convention = readConvention(sinksKey + ".assertMalloc.convention",
+										   getConvention("malloc", ArgumentReader::Cdecl));
+	mallocSink.clauses.push_back(makeSinkClause(0, ArgumentReader::getSlotWidth(mallocSink.convention),
+												getSinkSignedness("assertMalloc"), SinkOverflow, -1, 0));
+
+	SinkPredicate &stringAlloc = m_sinkPredicates["assert_string_alloc"];
+	stringAlloc.convention = readConvention(sinksKey + ".assert_string_alloc.convention",
+											getConvention("string_alloc", ArgumentReader::Cdecl));
+	stringAlloc.clauses.push_back(makeSinkClause(0, ArgumentReader::getSlotWidth(stringAlloc.convention),
+												 getSinkSignedness("assert_string_alloc"), SinkOverflow, -1, 0));
+
+	std::vector<std::string> sinks = cfg->getListKeys(sinksKey);
+	for (std::vector<std::string>::iterator it = sinks.begin(); it != sinks.end(); ++it) {
+		const std::string &sink = *it;
+		std::string key = sinksKey + "." + sink;
+		bool builtin = m_sinkPredicates.count(sink);
+		SinkPredicate &predicate = m_sinkPredicates[sink];
+		if (!builtin) {
+			predicate.convention = readConvention(key + ".convention",
+												  getConvention(sink.c_str(), ArgumentReader::Cdecl));
+			m_sinkSignedness[sink] = klee::OverflowPredicates::parseSignedness(
+				cfg->getString(getConfigKey() + ".signedness." + sink, "signed"));
+		}
+
+		std::vector<std::string> clauses = cfg->getListKeys(key + ".predicate");
+		if (!clauses.empty()) {
+			std::vector<SinkClause> compiled;
+			for (unsigned i = 0; i < clauses.size(); ++i) {
+				SinkClause clause;
+				if (compileSinkClause(key + ".predicate." + clauses[i], ArgumentReader::getSlotWidth(predicate.convention),
+									  getSinkSignedness(sink), clause))
+					compiled.push_back(clause);
+			}
+			predicate.clauses.swap(compiled);
+		}
+		if (predicate.clauses.empty()) {
+			s2e()->getWarningsStream() << "VulMining: sink " << sink << " has no valid predicate" << '\n';
+			continue;
+		}
+
+		bool ok = false;
+		uint64_t sinkPc = cfg->getInt(key + ".pc", 0, &ok);
+		if (ok && !builtin) {
+			m_assertFunVector.push_back(AssertFunPair(sink, sinkPc));
+			m_configuredSinks[sinkPc] = sink;
+		}
+	}
+
+	for (std::map<std::string, SinkPredicate>::iterator it = m_sinkPredicates.begin(); it != m_sinkPredicates.end(); ++it) {
+		SinkPredicate &predicate = it->second;
+		for (unsigned i = 0; i < predicate.clauses.size(); ++i) {
+			predicate.argCount = std::max(predicate.argCount, predicate.clauses[i].arg + 1);
+			if (predicate.clauses[i].boundArg >= 0)
+				predicate.argCount = std::max(predicate.argCount, (unsigned) predicate.clauses[i].boundArg + 1);
+		}
+	}
+}
+
+bool VulMining::evaluateSinkClause(const SinkClause &clause, const ArgumentReader &args)
+{
+	bool isSigned = clause.mode & klee::SignedOverflow;
+	uint64_t value = castValue(args.getValue(clause.arg), args.getWidth(), clause.width, isSigned);
+	if (clause.compare == SinkOverflow)
+		return isSigned && ((value >> (clause.width - 1)) & 1);
+
+	uint64_t bound = clause.bound;
+	if (clause.boundArg >= 0)
+		bound = truncateValue(castValue(args.getValue(clause.boundArg), args.getWidth(), clause.width, isSigned) + bound,
+							  clause.width);
+
+	if (isSigned) {
+		int64_t l = signedValue(value, clause.width), r = signedValue(bound, clause.width);
+		switch (clause.compare) {
+		case SinkEq: return l == r;
+		case SinkNe: return l != r;
+		case SinkLt: return l < r;
+		case SinkLe: return l <= r;
+		case SinkGt: return l > r;
+		default: return l >= r;
+		}
+	}
+	switch (clause.compare) {
+	case SinkEq: return value == bound;
+	case SinkNe: return value != bound;
+	case SinkLt: return value < bound;
+	case SinkLe: return value <= bound;
+	case SinkGt: return value > bound;
+	default: return value >= bound;
+	}
+}
+
+klee::ref<klee::Expr> VulMining::instantiateSinkClause(const SinkClause &clause, const ArgumentReader &args)
+{
+	bool isSigned = clause.mode & klee::SignedOverflow;
+	klee::ref<klee::Expr> value = castArgument(args.getExpr(clause.arg), clause.width, isSigned);
+	if (clause.compare == SinkOverflow)
+		return sizeOverflowCondition(value, clause.mode);
+
+	klee::ref<klee::Expr> bound = clause.boundExpr;
+	if (clause.boundArg >= 0) {
+		klee::ref<klee::Expr> other = castArgument(args.getExpr(clause.boundArg), clause.width, isSigned);
+		bound = clause.bound ? klee::AddExpr::create(other, clause.boundExpr) : other;
+	}
+
+	switch (clause.compare) {
+	case SinkEq: return klee::EqExpr::create(value, bound);
+	case SinkNe: return klee::NeExpr::create(value, bound);
+	case SinkLt: return isSigned ? klee::SltExpr::create(value, bound) : klee::UltExpr::create(value, bound);
+	case SinkLe: return isSigned ? klee::SleExpr::create(value, bound) : klee::UleExpr::create(value, bound);
+	case SinkGt: return isSigned ? klee::SgtExpr::create(value, bound) : klee::UgtExpr::create(value, bound);
+	default: return isSigned ? klee::SgeExpr::create(value, bound) : klee::UgeExpr::create(value, bound);
+	}
+}
+
+//配置文件中新增的断言：条件成立时只报告输入，不改变当前状态的约束
+void VulMining::assertConfiguredSink(S2EExecutionState *state, uint64_t pc)
+{
+	std::map<uint64_t, std::string>::const_iterator it = m_configuredSinks.find(pc);
+	if (it == m_configuredSinks.end())
+		return;
+	const char *sink = it->second.c_str();
+	const SinkPredicate &predicate = m_sinkPredicates[it->second];
+
+	ArgumentReader args(state, predicate.convention, predicate.argCount);
+	klee::ref<klee::Expr> cond;
+	if (evaluateSink(state, sink, pc, args, predicate, cond) != SinkSymbolic)
+		return;
+
+	reportSinkCondition(state, sink, pc, cond);
+}
+
+//符号条件的检查：可满足时报告一组输入，条件只临时加到当前状态上
+//返回true表示条件已经同步得出确定结论（异步提交的检查在reportSinkChecks中得出结论）
+bool VulMining::reportSinkCondition(S2EExecutionState *state, const char *sink, uint64_t pc,
+									const klee::ref<klee::Expr> &cond)
+{
+	s2e()->getMessagesStream(state) << sink << " pc " << hexval(pc) << '\n'
+									<< "---------assert cond : " << cond << '\n';
+
+	if (m_asyncSinks && submitSinkCheck(state, sink, pc, cond))
+		return false;
+
+	bool isTrue;
+	if (!solveSinkCondition(state, sink, pc, cond, isTrue))
+		return false;
+	if (!isTrue)
+		return true;
+
+	ConcreteInputs inputs;
+	klee::ConstraintManager constraintsBefore(state->constraints);
+	s2e()->getExecutor()->addConstraint(*state, cond);
+	s2e()->getExecutor()->getSymbolicSolution(*state, inputs);
+	state->constraints = constraintsBefore;
+
+	noteOverflowFork(state, sink);
+	s2e()->getMessagesStream() << "---------" << sink << " crash detected!" << '\n'
+							   << "---------input value : " << '\n';
+	for (ConcreteInputs::iterator it = inputs.begin(); it != inputs.end(); ++it) {
+		s2e()->getMessagesStream() << "---------" << it->first << " : ";
+		for (unsigned i = 0; i < it->second.size(); ++i)
+			s2e()->getMessagesStream() << hexval((unsigned char) it->second[i]) << " ";
+		s2e()->getMessagesStream() << '\n';
+	}
+	return true;
+}
+
+//6. 堆分配跟踪：heapAllocators.<函数名> = { pc = ..., sizeArg = 0, convention = "cdecl" }
+//   （HeapAlloc为sizeArg = 2, convention = "stdcall"），
+//   heapReleases.<函数名> = { pc = ..., ptrArg = 0 }（HeapFree为ptrArg = 2, convention = "stdcall"），
+//   heapCopies.<函数名> = { pc = ..., dstArg = 0, lenArg = 2 }，字符串拷贝用srcArg代替lenArg，
+//   symbolicBlockMaxSize：符号大小的块最多覆盖的字节数
+void VulMining::initializeHeapTracking()
+{
+	ConfigFile *cfg = s2e()->getConfig();
+	m_trackHeap = cfg->getBool(getConfigKey() + ".trackHeap");
+	if (!m_trackHeap)
+		return;
+
+	m_symbolicBlockMax = cfg->getInt(getConfigKey() + ".symbolicBlockMaxSize", 0x100000);
+
+	m_allocationReturnHook = registerReturnHook(&VulMining::onAllocationReturn);
+
+	//内置的malloc断言点同时是分配函数
+	for (AssertFunVector::iterator it = m_assertFunVector.begin(); it != m_assertFunVector.end(); ++it) {
+		if (it->first != "assertMalloc")
+			continue;
+		HeapAllocator allocator = { m_sinkPredicates["assertMalloc"].convention, 0 };
+		m_heapAllocators[it->second] = allocator;
+		m_pcHooks[it->second] |= HookAllocator;
+	}
+
+	std::string key = getConfigKey() + ".heapAllocators";
+	std::vector<std::string> names = cfg->getListKeys(key);
+	for (unsigned i = 0; i < names.size(); ++i) {
+		std::string k = key + "." + names[i];
+		bool ok = false;
+		uint64_t pc = cfg->getInt(k + ".pc", 0, &ok);
+		if (!ok) {
+			s2e()->getWarningsStream() << "VulMining: " << k << " needs a pc" << '\n';
+			continue;
+		}
+		HeapAllocator allocator;
+		allocator.convention = readConvention(k + ".convention",
+											  getConvention(names[i].c_str(), ArgumentReader::Cdecl));
+		allocator.sizeArg = cfg->getInt(k + ".sizeArg", 0);
+		m_heapAllocators[pc] = allocator;
+		m_pcHooks[pc] |= HookAllocator;
+	}
+
+	key = getConfigKey() + ".heapReleases";
+	names = cfg->getListKeys(key);
+	for (unsigned i = 0; i < names.size(); ++i) {
+		std::string k = key + "." + names[i];
+		bool ok = false;
+		uint64_t pc = cfg->getInt(k + ".pc", 0, &ok);
+		if (!ok) {
+			s2e()->getWarningsStream() << "VulMining: " << k << " needs a pc" << '\n';
+			continue;
+		}
+		HeapRelease release;
+		release.convention = readConvention(k + ".convention",
+											getConvention(names[i].c_str(), ArgumentReader::Cdecl));
+		release.ptrArg = cfg->getInt(k + ".ptrArg", 0);
+		m_heapReleases[pc] = release;
+		m_pcHooks[pc] |= HookRelease;
+	}
+
+	key = getConfigKey() + ".heapCopies";
+	names = cfg->getListKeys(key);
+	for (unsigned i = 0; i < names.size(); ++i) {
+		std::string k = key + "." + names[i];
+		bool ok = false;
+		uint64_t pc = cfg->getInt(k + ".pc", 0, &ok);
+		if (!ok) {
+			s2e()->getWarningsStream() << "VulMining: " << k << " needs a pc" << '\n';
+			continue;
+		}
+		HeapCopy copy;
+		copy.name = names[i];
+		copy.convention = readConvention(k + ".convention",
+										 getConvention(names[i].c_str(), ArgumentReader::Cdecl));
+		copy.dstArg = cfg->getInt(k + ".dstArg", 0);
+		copy.lenArg = cfg->getInt(k + ".lenArg", -1);
+		copy.srcArg = cfg->getInt(k + ".srcArg", 1);
+		m_heapCopies[pc] = copy;
+		m_pcHooks[pc] |= HookCopy;
+	}
+}
+
+//分配函数入口：记下大小，返回时才知道分配的地址
+void VulMining::onAllocatorCall(S2EExecutionState *state, uint64_t pc)
+{
+	const HeapAllocator &allocator = m_heapAllocators[pc];
+	ArgumentReader args(state, allocator.convention, allocator.sizeArg + 1);
+	pushReturnHook(state, m_allocationReturnHook, pc, args);
+}
+
+void VulMining::onAllocationReturn(S2EExecutionState *state, const VulMiningShadowFrame &frame)
+{
+	target_ulong address = 0;
+	if (!state->readCpuRegisterConcrete(CPU_OFFSET(regs[R_EAX]), &address, sizeof(address)) || !address)
+		return;
+
+	unsigned sizeArg = m_heapAllocators[frame.pc].sizeArg;
+	VulMiningState::HeapBlock block;
+	block.pc = frame.pc;
+	block.size = frame.values[sizeArg];
+	block.sizeExpr = frame.exprs[sizeArg];
+	DECLARE_PLUGINSTATE(VulMiningState, state);
+	if (!block.sizeExpr.isNull()) {
+		//符号大小的块只覆盖到大小的最大可能值，不能延伸到后面的块和栈、全局变量等地址上，
+		//因此以下一个块和symbolicBlockMaxSize为界，结果与分配的先后顺序无关
+		uint64_t limit = m_symbolicBlockMax, next = plgState->nextBlock(address);
+		if (next)
+			limit = std::min(limit, next - address);
+		block.size = symbolicBlockExtent(state, frame.pc, block.sizeExpr, limit);
+	}
+	plgState->addBlock(address, block);
+}
+
+//符号大小的最大可能值，不超过limit。二分查找的每次查询都计入分配点的时间预算，
+//预算用完或查询超时时返回已知的上界
+uint64_t VulMining::symbolicBlockExtent(S2EExecutionState *state, uint64_t pc, const klee::ref<klee::Expr> &size,
+										uint64_t limit)
+{
+	klee::Expr::Width width = size->getWidth();
+	if (width < 64)
+		limit = std::min(limit, (1ULL << width) - 1);
+
+	klee::ConstraintManager sliced = klee::ConstraintSlicer::get().slice(state->constraints, size);
+	//最大值在[lo, hi]中
+	uint64_t lo = 0, hi = limit;
+	while (lo < hi) {
+		uint64_t mid = lo + (hi - lo) / 2;
+		klee::SolverPool::Verdict verdict =
+			solveWithinBudget(pc, sliced, klee::UgtExpr::create(size, klee::ConstantExpr::create(mid, width)));
+		if (verdict == klee::SolverPool::AlwaysFalse)
+			hi = mid;
+		else if (verdict == klee::SolverPool::MayBeTrue)
+			lo = mid + 1;
+		else
+			break;
+	}
+	return hi;
+}
+
+//释放函数入口：以释放的指针为起始地址的块不再跟踪。没有配置释放函数时，
+//已释放的块一直留到同一地址被重新分配（addBlock去掉重叠的旧块）
+void VulMining::onReleaseCall(S2EExecutionState *state, uint64_t pc)
+{
+	const HeapRelease &release = m_heapReleases[pc];
+	ArgumentReader args(state, release.convention, release.ptrArg + 1);
+	if (!args.isConcrete(release.ptrArg))
+		return;
+	DECLARE_PLUGINSTATE(VulMiningState, state);
+	plgState->heap.erase(args.getValue(release.ptrArg));
+}
+
+void VulMining::onHeapCopy(S2EExecutionState *state, uint64_t pc)
+{
+	const HeapCopy &copy = m_heapCopies[pc];
+	unsigned count = std::max(copy.dstArg, copy.srcArg) + 1;
+	if (copy.lenArg >= 0)
+		count = std::max(count, (unsigned) copy.lenArg + 1);
+	ArgumentReader args(state, copy.convention, count);
+	checkHeapBounds(state, copy.name, pc, args, copy.dstArg, copy.lenArg, copy.srcArg);
+}
+
+void VulMining::connectPcHooks(ExecutionSignal *signal,
+							   S2EExecutionState *state,
+							   TranslationBlock *tb,
+							   uint64_t pc)
+{
+	std::map<uint64_t, unsigned>::const_iterator it = m_pcHooks.find(pc);
+	if (it == m_pcHooks.end())
+		return;
+	if (it->second & HookAllocator)
+		signal->connect(sigc::mem_fun(*this, &VulMining::onAllocatorCall));
+	if (it->second & HookCopy)
+		signal->connect(sigc::mem_fun(*this, &VulMining::onHeapCopy));
+	if (it->second & HookRelease)
+		signal->connect(sigc::mem_fun(*this, &VulMining::onReleaseCall));
+	if (it->second & HookReturn)
+		signal->connect(sigc::mem_fun(*this, &VulMining::onReturnSite));
+}
+
+unsigned VulMining::registerReturnHook(ReturnHandler handler)
+{
+	m_returnHandlers.push_back(handler);
+	return m_returnHandlers.size() - 1;
+}
+
+//在被拦截函数的第一条指令处调用：保存参数，返回地址加入插桩点
+bool VulMining::pushReturnHook(S2EExecutionState *state, unsigned hook, uint64_t pc, const ArgumentReader &args)
+{
+	VulMiningShadowFrame frame;
+	if (!args.getReturnAddress(frame.retaddr))
+		return false;
+	frame.sp = state->getSp();
+	frame.hook = hook;
+	frame.pc = pc;
+	for (unsigned i = 0; i < args.getCount(); ++i) {
+		frame.values.push_back(args.getValue(i));
+		frame.exprs.push_back(args.isConcrete(i) ? klee::ref<klee::Expr>() : args.getExpr(i));
+	}
+
+	DECLARE_PLUGINSTATE(VulMiningState, state);
+	plgState->shadowStack.push_back(frame);
+
+	//返回地址第一次出现时，已经翻译过的包含它的代码块没有插桩，只让这些块失效，
+	//不清空整个翻译缓存；返回地址所在的页还没有映射时也还没有翻译过
+	unsigned &kinds = m_pcHooks[frame.retaddr];
+	if (!(kinds & HookReturn)) {
+		kinds |= HookReturn;
+		uint64_t physical = state->getPhysicalAddress(frame.retaddr);
+		if (physical != (uint64_t) -1)
+			tb_invalidate_phys_page_range(physical, physical + 1, 0);
+	}
+	return true;
+}
+
+//栈指针已经越过的帧都已返回（包括被longjmp跳过的），其中返回到pc的那一帧触发处理函数
+void VulMining::onReturnSite(S2EExecutionState *state, uint64_t pc)
+{
+	DECLARE_PLUGINSTATE(VulMiningState, state);
+	std::vector<VulMiningShadowFrame> &stack = plgState->shadowStack;
+	uint64_t sp = state->getSp();
+	while (!stack.empty() && stack.back().sp < sp) {
+		VulMiningShadowFrame frame = stack.back();
+		stack.pop_back();
+		if (frame.retaddr == pc)
+			(this->*m_returnHandlers[frame.hook])(state, frame);
+	}
+}
+
+//目的地址落在跟踪的堆块中时，拷贝长度不能超过块中剩余的大小
+void VulMining::checkHeapBounds(S2EExecutionState *state, const std::string &sink, uint64_t pc,
+								const ArgumentReader &args, unsigned dstArg, int lenArg, unsigned srcArg)
+{
+	//符号化的目的地址不在这里检查
+	if (!args.isConcrete(dstArg))
+		return;
+
+	DECLARE_PLUGINSTATE(VulMiningState, state);
+	uint64_t dst = args.getValue(dstArg), start;
+	const VulMiningState::HeapBlock *block = plgState->findBlock(dst, start);
+	if (!block)
+		return;
+
+	std::string name = sink + ".heap";
+	SinkHits &hits = m_sinkHits[name];
+	uint64_t offset = dst - start;
+	klee::ref<klee::Expr> cond;
+
+	if (lenArg >= 0) {
+		if (args.isConcrete(lenArg) && block->sizeExpr.isNull()) {
+			++hits.concrete;
+			if (args.getValue(lenArg) <= block->size - offset)
+				return;
+			++hits.violated;
+			s2e()->getMessagesStream(state) << "---------" << name << " at " << hexval(pc) << ": length "
+											<< hexval(args.getValue(lenArg)) << " exceeds the "
+											<< hexval(block->size - offset) << " bytes left in the block at "
+											<< hexval(start) << '\n';
+			return;
+		}
+
+		klee::Expr::Width width = args.getWidth();
+		klee::ref<klee::Expr> size = block->sizeExpr.isNull() ? klee::ConstantExpr::create(block->size, width)
+															  : castArgument(block->sizeExpr, width, false);
+		klee::ref<klee::Expr> off = klee::ConstantExpr::create(offset, width);
+		cond = klee::OrExpr::create(klee::UltExpr::create(size, off),
+									klee::UgtExpr::create(args.getExpr(lenArg), klee::SubExpr::create(size, off)));
+	} else {
+		if (!block->sizeExpr.isNull() || !args.isConcrete(srcArg))
+			return;
+		cond = stringOverflowCondition(state, args.getValue(srcArg), block->size - offset);
+		if (cond.isNull() || cond->isFalse()) {
+			++hits.concrete;
+			return;
+		}
+		if (cond->isTrue()) {
+			++hits.concrete;
+			++hits.violated;
+			s2e()->getMessagesStream(state) << "---------" << name << " at " << hexval(pc) << ": the string at "
+											<< hexval(args.getValue(srcArg)) << " does not fit the "
+											<< hexval(block->size - offset) << " bytes left in the block at "
+											<< hexval(start) << '\n';
+			return;
+		}
+	}
+
+	++hits.symbolic;
+	reportSinkCondition(state, name.c_str(), pc, cond);
+}
+
+//源字符串的前remaining个字节中没有结束符时，拷贝会写出目的缓冲区。
+//具体的结束符出现得足够早、或者字符串太长不检查时返回空
+static const uint64_t MaxStringScan = 0x1000;
+
+klee::ref<klee::Expr> VulMining::stringOverflowCondition(S2EExecutionState *state, uint64_t src, uint64_t remaining)
+{
+	if (remaining > MaxStringScan)
+		return klee::ref<klee::Expr>();
+
+	klee::ref<klee::Expr> cond = klee::ConstantExpr::create(1, klee::Expr::Bool);
+	for (uint64_t i = 0; i < remaining; ++i) {
+		uint8_t byte;
+		if (state->readMemoryConcrete(src + i, &byte, 1)) {
+			if (!byte)
+				return klee::ref<klee::Expr>();
+			continue;
+		}
+		klee::ref<klee::Expr> value = state->readMemory(src + i, klee::Expr::Int8);
+		cond = klee::AndExpr::create(cond, klee::NeExpr::create(value, klee::ConstantExpr::create(0, klee::Expr::Int8)));
+	}
+	return cond;
+}
+
+//被拦截函数的调用约定：VulMining.callingConvention.<函数名>，第一次用到时读取
+ArgumentReader::Convention VulMining::getConvention(const char *function, ArgumentReader::Convention def)
+{
+	std::map<std::string, ArgumentReader::Convention>::iterator it = m_conventions.find(function);
+	if (it != m_conventions.end())
+		return it->second;
+	ArgumentReader::Convention convention = readConvention(getConfigKey() + ".callingConvention." + function, def);
+	m_conventions[function] = convention;
+	return convention;
+}
+
+//读取配置项key中的调用约定，没有配置时为def。当前目标不支持的调用约定在配置时就拒绝，
+//否则寄存器参数读不出来，断言会静默通过
+ArgumentReader::Convention VulMining::readConvention(const std::string &key, ArgumentReader::Convention def)
+{
+	std::string name = s2e()->getConfig()->getString(key, "");
+	if (name.empty())
+		return def;
+	ArgumentReader::Convention convention = ArgumentReader::parseConvention(name, def);
+	if (!ArgumentReader::isSupported(convention)) {
+		s2e()->getWarningsStream() << "VulMining: " << key << " = " << name
+								   << " is a 64-bit convention, not available on this target, ignored" << '\n';
+		return def;
+	}
+	return convention;
+}
+
+//断言在溢出后果分支上成立时，报告溢出最初发生的位置
+void VulMining::noteOverflowFork(S2EExecutionState *state, const char *sink)
+{
+	std::string origin;
+	uint64_t overflowPc;
+	if (!m_baseInstructions || !m_baseInstructions->getOverflowOrigin(state, origin, overflowPc))
+		return;
+	s2e()->getMessagesStream(state) << "---------" << sink << " reached by the overflow at "
+									<< hexval(overflowPc) << " (" << origin << ")" << '\n';
+}
+
 void VulMining::assert_string_alloc(S2EExecutionState *state, uint64_t pc)
 {
 	uint64_t sp, param1, param1Addr;
-	bool result;
 
 	sp = state->getSp();
-	param1Addr = sp + 0x4;
+	const SinkPredicate &predicate = m_sinkPredicates["assert_string_alloc"];
+	ArgumentReader args(state, predicate.convention, std::max(1u, predicate.argCount));
+	param1Addr = args.getAddress(0);
 
 	//s2e()->getWarningsStream() << "assert_string_alloc is called, the running pc: " << hexval(pc)<<std::endl;
 
-	result = state->readMemoryConcrete(param1Addr, &param1, sizeof(uint32_t));
-	//如果成功，表示这里是具体值，还不是符号化的值，则不为外部控制，则直接返回
-	if( result )
-	{
+	param1 = args.getValue(0);
+	//具体值直接计算，不为外部控制，不需要求解
+	klee::ref<klee::Expr> cond;
+	if (evaluateSink(state, "assert_string_alloc", pc, args, predicate, cond) != SinkSymbolic)
 		return;
-	}
 
 	s2e()->getWarningsStream() << "assert_string_alloc is called " <<'\n';
 
@@ -849,24 +1614,17 @@ void VulMining::assert_string_alloc(S2EExecutionState *state, uint64_t pc)
 							   << "---------param1 : " << hexval(param1) <<'\n'
 							   << "---------param1 address : " << hexval(param1Addr) <<'\n';
 
-    klee::ref<klee::Expr> symValue = state->readMemory(param1Addr, klee::Expr::Int32);
+    klee::ref<klee::Expr> symValue = args.getExpr(0);
 	s2e()->getWarningsStream() << "---------param1 symbolic value : " << symValue <<'\n';
 
-	klee::ref<klee::Expr> symValue_1 = klee::ZExtExpr::create(symValue, klee::Expr::Int64);
-	klee::ref<klee::Expr> symValue_2 = klee::SExtExpr::create(symValue, klee::Expr::Int64);
-
-	// klee::ref<klee::Expr> cond = klee::EqExpr::create(symValue, klee::ConstantExpr::create(0x8, symValue.get()->getWidth()));
-	klee::ref<klee::Expr> cond_1 = klee::UgtExpr::create(symValue_1, klee::ConstantExpr::create(0xffffffff, klee::Expr::Int64));
-	klee::ref<klee::Expr> cond_2 = klee::SgtExpr::create(symValue_2, klee::ConstantExpr::create(0x7fffffff, klee::Expr::Int64));
-	klee::ref<klee::Expr> cond = klee::EqExpr::create(klee::OrExpr::create(cond_1, cond_2),
-													  klee::ConstantExpr::create(0x1, klee::Expr::Bool));
 	s2e()->getMessagesStream() << "---------assert cond : " << cond <<'\n';
 
+	if (m_asyncSinks && submitSinkCheck(state, "assert_string_alloc", pc, cond))
+		return;
+
 	bool isTrue;
-	if (!(s2e()->getExecutor()->getSolver()->mayBeTrue(klee::Query(state->constraints, cond), isTrue))) {
-		s2e()->getWarningsStream() << "Failed to assert the condition" <<'\n';
+	if (!solveSinkCondition(state, "assert_string_alloc", pc, cond, isTrue))
 		return;
-    }
 	if (isTrue) {
 		bool res_1;
 		ConcreteInputs inputs;
@@ -896,6 +1654,675 @@ void VulMining::assert_string_alloc(S2EExecutionState *state, uint64_t pc)
 }
 
 
+klee::OverflowSignedness VulMining::getSinkSignedness(const std::string &sink) const
+{
+	std::map<std::string, klee::OverflowSignedness>::const_iterator it = m_sinkSignedness.find(sink);
+	return it == m_sinkSignedness.end() ? klee::SignedOverflow : it->second;
+}
+
+//把断言条件和相关的约束切片提交给求解进程池，状态不等待结果继续执行
+bool VulMining::submitSinkCheck(S2EExecutionState *state, const char *sink,
+								uint64_t pc, const klee::ref<klee::Expr> &cond)
+{
+	//折叠为常量的条件不需要求解器，仍然同步处理
+	if (llvm::isa<klee::ConstantExpr>(cond))
+		return false;
+
+	queueSinkCheck(state, sink, pc, cond, klee::SolverPool::getQueryTimeout(), false);
+
+	s2e()->getMessagesStream() << "---------" << sink << " check queued ("
+							   << m_pendingSinkChecks.size() << " pending)" << '\n';
+	return true;
+}
+
+//求解断言条件，受单次查询超时和每个断言点的时间预算限制。
+//返回false表示求解失败或结果未知（未知的结果按配置放入低优先级队列重试）
+bool VulMining::solveSinkCondition(S2EExecutionState *state, const char *sink, uint64_t pc,
+								   const klee::ref<klee::Expr> &cond, bool &isTrue)
+{
+	if (klee::OverflowPredicates::isFolded(cond, isTrue))
+		return true;
+
+	double budget = klee::SolverPool::getSiteBudget();
+	if (budget > 0 && m_siteSolverTime[pc] >= budget) {
+		recordUnknownSink(state, sink, pc, cond, "site budget exhausted");
+		return false;
+	}
+
+	klee::ConstraintManager sliced = klee::ConstraintSlicer::get().slice(state->constraints, cond);
+	klee::SolverPool::Verdict verdict = solveWithinBudget(pc, sliced, cond);
+
+	switch (verdict) {
+	case klee::SolverPool::MayBeTrue:
+	case klee::SolverPool::AlwaysFalse:
+		isTrue = verdict == klee::SolverPool::MayBeTrue;
+		return true;
+	case klee::SolverPool::TimedOut:
+		recordUnknownSink(state, sink, pc, cond,
+						  budget > 0 && m_siteSolverTime[pc] >= budget ? "site budget exhausted" : "query timed out");
+		return false;
+	default:
+		s2e()->getWarningsStream() << sink << " at " << hexval(pc)
+								   << ": failed to assert the condition" << '\n';
+		return false;
+	}
+}
+
+//在pc剩余的时间预算内求解，预算已经用完时返回TimedOut
+klee::SolverPool::Verdict VulMining::solveWithinBudget(uint64_t pc, const klee::ConstraintManager &constraints,
+													   const klee::ref<klee::Expr> &cond)
+{
+	double budget = klee::SolverPool::getSiteBudget();
+	double &spent = m_siteSolverTime[pc];
+	if (budget > 0 && spent >= budget)
+		return klee::SolverPool::TimedOut;
+
+	//单次查询不超过剩余的预算
+	double limit = klee::SolverPool::getQueryLimit(budget > 0 ? budget - spent : 0);
+	double start = klee::util::getWallTime();
+	klee::SolverPool::Verdict verdict;
+	bool isTrue;
+	if (limit > 0) {
+		//执行器的求解器不能中断，有时间限制的查询交给常驻的求解进程
+		verdict = klee::SolverPool::solveNow(constraints, cond, limit).verdict;
+	} else if (s2e()->getExecutor()->getSolver()->mayBeTrue(klee::Query(constraints, cond), isTrue)) {
+		verdict = isTrue ? klee::SolverPool::MayBeTrue : klee::SolverPool::AlwaysFalse;
+	} else {
+		verdict = klee::SolverPool::Failed;
+	}
+	spent += klee::util::getWallTime() - start;
+	return verdict;
+}
+
+//记录结果未知的断言；配置了重试超时时，用放宽的超时放入低优先级队列，结果在定时器中报告
+void VulMining::recordUnknownSink(S2EExecutionState *state, const char *sink, uint64_t pc,
+								  const klee::ref<klee::Expr> &cond, const char *reason)
+{
+	++klee::stats::overflowUnknown;
+	s2e()->getWarningsStream() << "---------" << sink << " at " << hexval(pc)
+							   << ": unknown (" << reason << ")" << '\n';
+
+	klee::SolverPool *pool = klee::SolverPool::get();
+	double retryTimeout = klee::SolverPool::getRetryTimeout();
+	if (!pool || retryTimeout <= 0)
+		return;
+
+	queueSinkCheck(state, sink, pc, cond, retryTimeout, true);
+}
+
+//只把约束切片提交给进程池；完整约束和符号数组保存下来，条件可满足时用来求报告的输入
+void VulMining::queueSinkCheck(S2EExecutionState *state, const char *sink, uint64_t pc,
+							   const klee::ref<klee::Expr> &cond, double timeout, bool retry)
+{
+	PendingSinkCheck check;
+	check.ticket = klee::SolverPool::get()->submit(
+		klee::ConstraintSlicer::get().slice(state->constraints, cond), cond, false,
+		timeout, retry);
+	check.sink = sink;
+	check.pc = pc;
+	check.stateId = state->getID();
+	check.retry = retry;
+	check.constraints = state->constraints;
+	check.cond = cond;
+	for (unsigned i = 0; i < state->symbolics.size(); ++i)
+		check.symbolics.push_back(state->symbolics[i].second);
+	m_pendingSinkChecks.push_back(check);
+}
+
+//和同步路径的getSymbolicSolution一样，在完整约束加上断言条件下求所有符号输入的值
+bool VulMining::getSinkCheckInputs(const PendingSinkCheck &check, ConcreteInputs &inputs)
+{
+	klee::ConstraintManager constraints(check.constraints);
+	constraints.addConstraint(check.cond);
+	std::vector<std::vector<unsigned char> > values;
+	klee::Query query(constraints, klee::ConstantExpr::alloc(0, klee::Expr::Bool));
+	if (!s2e()->getExecutor()->getSolver()->getInitialValues(query, check.symbolics, values))
+		return false;
+	for (unsigned i = 0; i < check.symbolics.size(); ++i)
+		inputs.push_back(std::make_pair(check.symbolics[i]->name, values[i]));
+	return true;
+}
+
+//取回已经完成的异步检查并报告，wait为true时等待全部完成
+void VulMining::reportSinkChecks(bool wait)
+{
+	klee::SolverPool *pool = klee::SolverPool::get();
+	std::list<PendingSinkCheck>::iterator it = m_pendingSinkChecks.begin();
+	while (it != m_pendingSinkChecks.end()) {
+		klee::SolverPool::Result result;
+		if (wait) {
+			result = pool->wait(it->ticket);
+		} else if (!pool->poll(it->ticket, result)) {
+			++it;
+			continue;
+		}
+
+		//确定的结论才记录，超时和失败的算术检查以后重新检查
+		if (it->sink == "inlineOverflow" &&
+			(result.verdict == klee::SolverPool::MayBeTrue || result.verdict == klee::SolverPool::AlwaysFalse))
+			noteArithChecked(it->arithKey);
+
+		if (result.verdict == klee::SolverPool::TimedOut) {
+			++klee::stats::overflowUnknown;
+			s2e()->getWarningsStream() << "---------" << it->sink << " at " << hexval(it->pc)
+									   << ": unknown (query timed out"
+									   << (it->retry ? " again" : "") << ")" << '\n';
+		} else if (result.verdict == klee::SolverPool::Failed) {
+			s2e()->getWarningsStream() << it->sink << " at " << hexval(it->pc)
+									   << ": failed to assert the condition" << '\n';
+		} else if (it->retry && result.verdict == klee::SolverPool::AlwaysFalse) {
+			s2e()->getMessagesStream() << "---------" << it->sink << " at " << hexval(it->pc)
+									   << ": unknown resolved on retry, no crash" << '\n';
+		} else if (result.verdict == klee::SolverPool::MayBeTrue) {
+			ConcreteInputs inputs;
+			if (!getSinkCheckInputs(*it, inputs))
+				s2e()->getWarningsStream() << it->sink << " at " << hexval(it->pc)
+										   << ": failed to solve the inputs" << '\n';
+			s2e()->getMessagesStream() << "---------" << it->sink << " crash detected! (pc "
+									   << hexval(it->pc) << ", state " << it->stateId << ")" << '\n'
+									   << "---------input value : " << '\n';
+			for (unsigned i = 0; i < inputs.size(); ++i) {
+				const VarValuePair &vp = inputs[i];
+				s2e()->getMessagesStream() << "---------" << vp.first << " : ";
+				for (unsigned j = 0; j < vp.second.size(); ++j)
+					s2e()->getMessagesStream() << hexval((unsigned char) vp.second[j]) << " ";
+				s2e()->getMessagesStream() << '\n';
+			}
+		}
+		it = m_pendingSinkChecks.erase(it);
+	}
+}
+
+void VulMining::onTimer()
+{
+	reportSinkChecks(false);
+}
+
+int VulMining::findInlineRange(uint64_t pc) const
+{
+	for (unsigned i = 0; i < m_inlineRanges.size(); ++i) {
+		if (pc >= m_inlineRanges[i].first && pc < m_inlineRanges[i].second)
+			return i;
+	}
+	return -1;
+}
+
+//算术指令表文件头，起始地址和大小必须与配置的范围一致，校验和必须与内存中的代码一致
+struct ArithSiteMapHeader {
+	char magic[8];
+	uint64_t start;
+	uint64_t size;
+	uint64_t checksum;
+	uint64_t count;
+};
+static const char ArithSiteMapMagic[8] = { 'S', '2', 'E', 'A', 'R', 'I', 'T', 'H' };
+
+std::string VulMining::getArithSiteMapPath(unsigned range) const
+{
+	std::stringstream ss;
+	ss << m_arithSiteMapDir << "/arith-" << std::hex << m_inlineRanges[range].first << "-"
+	   << (m_inlineRanges[range].second - m_inlineRanges[range].first) << ".map";
+	return ss.str();
+}
+
+//解析target_disas输出的一行（AT&T语法），例如"0x00401000:  addl   $0x1,0x8(%ebp)"。
+//排除条件与decodeArithmetic相同：以CL为移位数或移位数为0的shl不插桩
+bool VulMining::parseArithmetic(const std::string &line, uint64_t &address, ArithInstruction &insn)
+{
+	unsigned long long addr;
+	if (sscanf(line.c_str(), "0x%llx:", &addr) != 1)
+		return false;
+	address = addr;
+
+	std::istringstream is(line.substr(line.find(':') + 1));
+	std::string mnemonic, operands;
+	is >> mnemonic;
+	while (mnemonic == "lock" || mnemonic == "data16" || mnemonic == "data32")
+		is >> mnemonic;
+	is >> operands;
+
+	static const char *const bases[] = { "add", "sub", "imul", "mul", "shl", "sal" };
+	static const ArithKind kinds[] = { ArithAdd, ArithSub, ArithMul, ArithMul, ArithShl, ArithShl };
+	unsigned k = 0;
+	std::string suffix;
+	for (; k < sizeof(bases) / sizeof(bases[0]); ++k) {
+		std::string base = bases[k];
+		if (mnemonic.compare(0, base.size(), base) == 0 && mnemonic.size() <= base.size() + 1) {
+			suffix = mnemonic.substr(base.size());
+			break;
+		}
+	}
+	if (k == sizeof(bases) / sizeof(bases[0]))
+		return false;
+	if (!suffix.empty() && suffix != "b" && suffix != "w" && suffix != "l")
+		return false;
+	insn.kind = kinds[k];
+
+	if (insn.kind == ArithShl) {
+		if (operands.compare(0, 4, "%cl,") == 0)
+			return false;
+		unsigned long count;
+		if (sscanf(operands.c_str(), "$0x%lx", &count) == 1 && (count & 0x1f) == 0)
+			return false;
+	}
+
+	//位宽：优先用后缀，否则看第一个寄存器操作数
+	insn.width = klee::Expr::Int32;
+	if (suffix == "b") {
+		insn.width = klee::Expr::Int8;
+	} else if (suffix == "w") {
+		insn.width = klee::Expr::Int16;
+	} else if (suffix.empty()) {
+		//最后一个不在内存操作数括号中的寄存器
+		std::string::size_type r = std::string::npos;
+		int depth = 0;
+		for (std::string::size_type i = 0; i + 2 < operands.size(); ++i) {
+			if (operands[i] == '(')
+				++depth;
+			else if (operands[i] == ')')
+				--depth;
+			else if (operands[i] == '%' && depth == 0)
+				r = i;
+		}
+		if (r != std::string::npos) {
+			if (operands[r + 2] == 'l' || operands[r + 2] == 'h')
+				insn.width = klee::Expr::Int8;
+			else if (operands[r + 1] != 'e')
+				insn.width = klee::Expr::Int16;
+		}
+	}
+	return true;
+}
+
+//线性反汇编整个范围。数据区会被当作指令解码，可能使后面几条指令错位，
+//所以这张表只用作白名单，不能保证列出所有算术指令
+bool VulMining::buildArithSiteMap(unsigned range, const std::string &path, uint64_t checksum)
+{
+	uint64_t start = m_inlineRanges[range].first;
+	uint64_t size = m_inlineRanges[range].second - start;
+
+	FILE *disas = tmpfile();
+	if (!disas)
+		return false;
+	target_disas(disas, start, size, 0);
+	rewind(disas);
+
+	std::vector<ArithSiteRecord> records;
+	char buf[512];
+	while (fgets(buf, sizeof(buf), disas)) {
+		uint64_t address;
+		ArithInstruction insn;
+		if (!parseArithmetic(buf, address, insn) || address < start || address - start >= size)
+			continue;
+		ArithSiteRecord record = { (uint32_t) (address - start), (uint8_t) insn.kind, (uint8_t) insn.width, 0 };
+		records.push_back(record);
+	}
+	fclose(disas);
+
+	std::sort(records.begin(), records.end(), arithSiteLess);
+
+	FILE *out = fopen(path.c_str(), "wb");
+	if (!out)
+		return false;
+	ArithSiteMapHeader header;
+	memcpy(header.magic, ArithSiteMapMagic, sizeof(header.magic));
+	header.start = start;
+	header.size = size;
+	header.checksum = checksum;
+	header.count = records.size();
+	bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+	if (ok && !records.empty())
+		ok = fwrite(&records[0], sizeof(ArithSiteRecord), records.size(), out) == records.size();
+	ok &= fclose(out) == 0;
+
+	s2e()->getMessagesStream() << "VulMining: " << records.size() << " arithmetic instructions in "
+							   << hexval(start) << "+" << hexval(size) << " written to " << path << '\n';
+	return ok;
+}
+
+//范围内代码的校验和（FNV-1a），重新编译的模块即使基址和大小不变也会得到不同的值。
+//有页面不可读（还没有载入）时返回false
+bool VulMining::checksumArithRange(S2EExecutionState *state, unsigned range, uint64_t &checksum)
+{
+	uint64_t end = m_inlineRanges[range].second;
+	uint8_t page[TARGET_PAGE_SIZE];
+	checksum = 0xcbf29ce484222325ULL;
+	for (uint64_t addr = m_inlineRanges[range].first; addr < end; ) {
+		uint64_t next = (addr & ~(uint64_t) (TARGET_PAGE_SIZE - 1)) + TARGET_PAGE_SIZE;
+		unsigned len = std::min(next, end) - addr;
+		if (!state->readMemoryConcrete(addr, page, len))
+			return false;
+		for (unsigned i = 0; i < len; ++i) {
+			checksum ^= page[i];
+			checksum *= 0x100000001b3ULL;
+		}
+		addr += len;
+	}
+	return true;
+}
+
+//映射算术指令表，文件不存在或与内存中的代码不一致时重新生成
+bool VulMining::loadArithSiteMap(unsigned range, uint64_t checksum)
+{
+	ArithSiteMap &map = m_arithSiteMaps[range];
+	std::string path = getArithSiteMapPath(range);
+
+	struct stat st;
+	bool exists = stat(path.c_str(), &st) == 0;
+	for (unsigned attempt = 0; attempt < 2; ++attempt) {
+		if ((attempt > 0 || !exists) && !buildArithSiteMap(range, path, checksum))
+			return false;
+
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(ArithSiteMapHeader)) {
+			close(fd);
+			continue;
+		}
+		void *mapping = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED)
+			return false;
+
+		const ArithSiteMapHeader *header = (const ArithSiteMapHeader *) mapping;
+		if (memcmp(header->magic, ArithSiteMapMagic, sizeof(header->magic)) != 0 ||
+			header->start != m_inlineRanges[range].first ||
+			header->size != m_inlineRanges[range].second - m_inlineRanges[range].first ||
+			header->checksum != checksum ||
+			sizeof(ArithSiteMapHeader) + header->count * sizeof(ArithSiteRecord) > (size_t) st.st_size) {
+			s2e()->getWarningsStream() << "VulMining: " << path << " does not match the module in memory"
+									   << (attempt ? "" : ", rebuilding") << '\n';
+			munmap(mapping, st.st_size);
+			continue;
+		}
+
+		map.mapping = mapping;
+		map.mappingSize = st.st_size;
+		map.sites = (const ArithSiteRecord *) (header + 1);
+		map.count = header->count;
+		return true;
+	}
+	return false;
+}
+
+const VulMining::ArithSiteRecord *VulMining::findArithSite(S2EExecutionState *state, unsigned range, uint64_t pc)
+{
+	ArithSiteMap &map = m_arithSiteMaps[range];
+	if (!map.loaded && (map.retryIn == 0 || --map.retryIn == 0)) {
+		uint64_t checksum;
+		if (!checksumArithRange(state, range, checksum)) {
+			//不完整的模块不能反汇编成表，先逐条解码，稍后再试
+			map.failed = true;
+			map.retryIn = 1000;
+		} else {
+			map.loaded = true;
+			map.failed = !loadArithSiteMap(range, checksum);
+			if (map.failed)
+				s2e()->getWarningsStream() << "VulMining: no arithmetic site map for "
+										   << hexval(m_inlineRanges[range].first) << ", decoding instructions" << '\n';
+		}
+	}
+	if (map.failed)
+		return 0;
+
+	ArithSiteRecord key = { (uint32_t) (pc - m_inlineRanges[range].first), 0, 0, 0 };
+	const ArithSiteRecord *end = map.sites + map.count;
+	const ArithSiteRecord *it = std::lower_bound(map.sites, end, key, arithSiteLess);
+	return it != end && it->offset == key.offset ? it : 0;
+}
+
+//ModRM（以及SIB和偏移）的长度，用来找到移位指令的立即数
+static unsigned modrmLength(const uint8_t *code, unsigned size)
+{
+	if (size == 0)
+		return 0;
+	uint8_t mod = code[0] >> 6, rm = code[0] & 7;
+	unsigned len = 1;
+	if (mod == 3)
+		return len;
+	if (rm == 4) {
+		if (size < 2)
+			return 0;
+		++len;
+		if (mod == 0 && (code[1] & 7) == 5)
+			len += 4;
+	} else if (mod == 0 && rm == 5) {
+		len += 4;
+	}
+	if (mod == 1)
+		len += 1;
+	else if (mod == 2)
+		len += 4;
+	return len;
+}
+
+//识别32位代码中会溢出的算术指令及其操作数位宽。
+//以CL为移位数的shl不插桩：移位数为0时QEMU不更新cc_src/cc_dst，里面是上一条指令的值
+bool VulMining::decodeArithmetic(const uint8_t *code, unsigned size, ArithInstruction &insn)
+{
+	unsigned i = 0;
+	klee::Expr::Width width = klee::Expr::Int32;
+	for (; i < size; ++i) {
+		uint8_t b = code[i];
+		if (b == 0x66)
+			width = klee::Expr::Int16;
+		else if (b != 0xf0 && b != 0xf2 && b != 0xf3 && b != 0x2e && b != 0x36 &&
+				 b != 0x3e && b != 0x26 && b != 0x64 && b != 0x65)
+			break;
+	}
+	if (i + 1 >= size)
+		return false;
+
+	uint8_t op = code[i++];
+	uint8_t reg = (code[i] >> 3) & 7;
+	switch (op) {
+	case 0x00: case 0x02: case 0x04:
+		insn.kind = ArithAdd; insn.width = klee::Expr::Int8; return true;
+	case 0x01: case 0x03: case 0x05:
+		insn.kind = ArithAdd; insn.width = width; return true;
+	case 0x28: case 0x2a: case 0x2c:
+		insn.kind = ArithSub; insn.width = klee::Expr::Int8; return true;
+	case 0x29: case 0x2b: case 0x2d:
+		insn.kind = ArithSub; insn.width = width; return true;
+	case 0x80: case 0x81: case 0x83:
+		if (reg != 0 && reg != 5)
+			return false;
+		insn.kind = reg == 0 ? ArithAdd : ArithSub;
+		insn.width = op == 0x80 ? klee::Expr::Int8 : width;
+		return true;
+	case 0x69: case 0x6b:
+		insn.kind = ArithMul; insn.width = width; return true;
+	case 0x0f:
+		if (code[i] != 0xaf)
+			return false;
+		insn.kind = ArithMul; insn.width = width; return true;
+	case 0xf6: case 0xf7:
+		if (reg != 4 && reg != 5)
+			return false;
+		insn.kind = ArithMul;
+		insn.width = op == 0xf6 ? klee::Expr::Int8 : width;
+		return true;
+	case 0xd0: case 0xd1: case 0xc0: case 0xc1: {
+		//shl与sal（/4和/6）
+		if (reg != 4 && reg != 6)
+			return false;
+		if (op == 0xc0 || op == 0xc1) {
+			unsigned len = modrmLength(code + i, size - i);
+			if (!len || i + len >= size || (code[i + len] & 0x1f) == 0)
+				return false;
+		}
+		insn.kind = ArithShl;
+		insn.width = (op == 0xd0 || op == 0xc0) ? klee::Expr::Int8 : width;
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+void VulMining::onTranslateArithmetic(ExecutionSignal *signal,
+									  S2EExecutionState *state,
+									  TranslationBlock *tb,
+									  uint64_t pc)
+{
+	int range = findInlineRange(pc);
+	if (range < 0)
+		return;
+
+	//有算术指令表时只需二分查找，不在表中的指令不插桩
+	ArithInstruction insn;
+	if (!m_arithSiteMapDir.empty()) {
+		const ArithSiteRecord *site = findArithSite(state, range, pc);
+		if (site) {
+			insn.kind = (ArithKind) site->kind;
+			insn.width = site->width;
+		} else if (!m_arithSiteMaps[range].failed) {
+			return;
+		}
+	}
+
+	if (m_arithSiteMapDir.empty() || m_arithSiteMaps[range].failed) {
+		//一次读出指令字节；下一页不可读时只读到本页末尾
+		uint8_t code[16];
+		unsigned size = sizeof(code);
+		if (!state->readMemoryConcrete(pc, code, size)) {
+			size = TARGET_PAGE_SIZE - (pc & (TARGET_PAGE_SIZE - 1));
+			if (size >= sizeof(code) || !state->readMemoryConcrete(pc, code, size))
+				return;
+		}
+		if (!decodeArithmetic(code, size, insn))
+			return;
+	}
+
+	//解码结果绑定到回调上，执行时不再查表
+	++m_arithTranslations;
+	signal->connect(sigc::bind(sigc::mem_fun(*this, &VulMining::checkArithmetic), insn));
+}
+
+//指令执行后检查：cc_dst是结果，cc_src是add/sub的第二个操作数、mul的高半部分（imul为截断误差）、
+//shl最后一次移位前的值。两者都是具体值时直接返回，不构造表达式
+void VulMining::checkArithmetic(S2EExecutionState *state, uint64_t pc, ArithInstruction insn)
+{
+	uint32_t concreteSrc, concreteDst;
+	if (state->readCpuRegisterConcrete(CPU_OFFSET(cc_src), &concreteSrc, sizeof(concreteSrc)) &&
+		state->readCpuRegisterConcrete(CPU_OFFSET(cc_dst), &concreteDst, sizeof(concreteDst))) {
+		++m_inlineConcreteHits;
+		return;
+	}
+	++m_inlineSymbolicHits;
+
+	klee::Expr::Width w = insn.width;
+	klee::ref<klee::Expr> src = state->readCpuRegister(CPU_OFFSET(cc_src), klee::Expr::Int32);
+	klee::ref<klee::Expr> dst = state->readCpuRegister(CPU_OFFSET(cc_dst), klee::Expr::Int32);
+
+	//循环中重复执行到的同一检查只需一次查找，不构造条件
+	ArithCheckKey key = makeArithCheckKey(pc, insn, src, dst);
+	if (m_inlineDedup && isArithChecked(key)) {
+		++m_inlineDuplicateHits;
+		return;
+	}
+
+	klee::ref<klee::Expr> op2 = klee::ExtractExpr::create(src, 0, w);
+	klee::ref<klee::Expr> res = klee::ExtractExpr::create(dst, 0, w);
+
+	klee::ref<klee::Expr> cond;
+	switch (insn.kind) {
+	case ArithAdd:
+		cond = klee::OverflowPredicates::add(klee::SubExpr::create(res, op2), op2, res, m_inlineSignedness);
+		break;
+	case ArithSub:
+		cond = klee::OverflowPredicates::sub(klee::AddExpr::create(res, op2), op2, res, m_inlineSignedness);
+		break;
+	case ArithMul:
+		//mul/imul本身决定了语义，cc_src非零即溢出
+		cond = klee::NeExpr::create(src, klee::OverflowConstants::get(klee::Expr::Int32).zero);
+		break;
+	case ArithShl: {
+		//只能看到最后移出的一位：无符号为CF（cc_src的最高位），有符号为OF（CF与结果最高位不同）
+		const klee::OverflowConstants &k = klee::OverflowConstants::get(w);
+		klee::ref<klee::Expr> condu, conds;
+		if (m_inlineSignedness & klee::UnsignedOverflow)
+			condu = klee::SltExpr::create(op2, k.zero);
+		if (m_inlineSignedness & klee::SignedOverflow)
+			conds = klee::SltExpr::create(klee::XorExpr::create(op2, res), k.zero);
+		cond = condu.isNull() ? conds : conds.isNull() ? condu : klee::OrExpr::create(condu, conds);
+		break;
+	}
+	}
+
+	//求解和报告与其他断言相同，溢出条件只临时加到状态上；异步提交的检查得出确定结论后再记录
+	size_t pending = m_pendingSinkChecks.size();
+	if (reportSinkCondition(state, "inlineOverflow", pc, cond))
+		noteArithChecked(key);
+	else if (m_pendingSinkChecks.size() > pending)
+		m_pendingSinkChecks.back().arithKey = key;
+}
+
+//MurmurHash3的混合函数，把表达式的32位哈希值扩散到64位
+static uint64_t mixArithHash(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+VulMining::ArithCheckKey VulMining::makeArithCheckKey(uint64_t pc, ArithInstruction insn,
+													  const klee::ref<klee::Expr> &src, const klee::ref<klee::Expr> &dst)
+{
+	ArithCheckKey key;
+	key.pc = pc;
+	key.kind = insn.kind;
+	key.width = insn.width;
+	key.src = src;
+	key.dst = dst;
+	//表达式的哈希值在构造时已经算好，计算指纹不遍历表达式
+	uint64_t h = mixArithHash(pc ^ ((uint64_t) insn.kind << 56) ^ ((uint64_t) insn.width << 48));
+	h = mixArithHash(h ^ src->hash());
+	key.fingerprint = mixArithHash(h ^ ((uint64_t) dst->hash() << 32));
+	return key;
+}
+
+bool VulMining::isArithChecked(const ArithCheckKey &key)
+{
+	std::map<uint64_t, CheckedArith>::iterator it = m_checkedAriths.find(key.fingerprint);
+	if (it == m_checkedAriths.end())
+		return false;
+	const ArithCheckKey &checked = it->second.key;
+	if (checked.pc != key.pc || checked.kind != key.kind || checked.width != key.width ||
+		checked.src != key.src || checked.dst != key.dst)
+		return false;
+	m_checkedArithLru.splice(m_checkedArithLru.begin(), m_checkedArithLru, it->second.lru);
+	return true;
+}
+
+void VulMining::noteArithChecked(const ArithCheckKey &key)
+{
+	if (!m_inlineDedup || m_inlineDedupCapacity == 0)
+		return;
+
+	//指纹冲突时新的键替换旧的，被替换的检查最多再做一次
+	std::map<uint64_t, CheckedArith>::iterator it = m_checkedAriths.find(key.fingerprint);
+	if (it != m_checkedAriths.end()) {
+		it->second.key = key;
+		m_checkedArithLru.splice(m_checkedArithLru.begin(), m_checkedArithLru, it->second.lru);
+		return;
+	}
+
+	if (m_checkedAriths.size() >= m_inlineDedupCapacity) {
+		m_checkedAriths.erase(m_checkedArithLru.back());
+		m_checkedArithLru.pop_back();
+	}
+	m_checkedArithLru.push_front(key.fingerprint);
+	CheckedArith &entry = m_checkedAriths[key.fingerprint];
+	entry.key = key;
+	entry.lru = m_checkedArithLru.begin();
+}
+
+
 std::string itoa(int value, int base) {
 
 
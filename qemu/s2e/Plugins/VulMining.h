@@ -44,6 +44,14 @@
 #include <s2e/Plugins/CorePlugin.h>
 #include <s2e/Plugins/OSMonitor.h>//这里包含了OSMonitor
 
+#include "ArgumentReader.h"
+#include "BaseInstructions.h"
+
+#include <klee/SolverPool.h>
+#include <klee/util/OverflowPredicates.h>
+
+#include <list>
+#include <map>
 
 
 #include <vector>
@@ -57,6 +65,16 @@ extern "C" void target_disas(FILE *out, target_ulong code, target_ulong size, in
 namespace s2e {
 namespace plugins {
 
+//影子栈上的一帧：被拦截函数入口处的返回地址、栈指针和参数（具体值时expr为空）
+struct VulMiningShadowFrame {
+    uint64_t retaddr;
+    uint64_t sp;
+    unsigned hook;
+    uint64_t pc;
+    std::vector<uint64_t> values;
+    std::vector<klee::ref<klee::Expr> > exprs;
+};
+
 class VulMining:public Plugin //这里是需要修改的一个地方
 {
     S2E_PLUGIN
@@ -99,8 +117,232 @@ private:
 
     sigc::connection m_sig_setReceiveInputsSymbolicVar;
 
+    //内联算术检查的去重键：条件由pc处的指令和cc_src/cc_dst决定，不必构造条件就能查找
+    struct ArithCheckKey {
+        uint64_t pc;
+        int kind;
+        unsigned width;
+        klee::ref<klee::Expr> src, dst;
+        uint64_t fingerprint;
+    };
+
+    //异步模式：断言只提交给求解进程池，状态继续执行，结果在定时器中取回并报告
+    struct PendingSinkCheck {
+        klee::SolverPool::Ticket ticket;
+        std::string sink;
+        uint64_t pc;
+        int stateId;
+        bool retry;     //超时后用放宽的超时重新提交的查询
+        //提交的只是约束切片，其模型不是有效输入；报告输入时用提交时状态的完整约束重新求解
+        klee::ConstraintManager constraints;
+        klee::ref<klee::Expr> cond;
+        std::vector<const klee::Array*> symbolics;
+        ArithCheckKey arithKey;     //内联算术检查（sink为inlineOverflow）得出确定结论后记录
+    };
+    bool m_asyncSinks;
+    std::list<PendingSinkCheck> m_pendingSinkChecks;
+    //每个断言检查的溢出语义（配置项signedness.<断言名>）
+    std::map<std::string, klee::OverflowSignedness> m_sinkSignedness;
+    klee::OverflowSignedness getSinkSignedness(const std::string &sink) const;
+
+    //每个断言点（以及分配点）已经使用的求解时间（秒）
+    std::map<uint64_t, double> m_siteSolverTime;
+    klee::SolverPool::Verdict solveWithinBudget(uint64_t pc, const klee::ConstraintManager &constraints,
+                                                const klee::ref<klee::Expr> &cond);
+
+    bool solveSinkCondition(S2EExecutionState *state, const char *sink, uint64_t pc,
+                            const klee::ref<klee::Expr> &cond, bool &isTrue);
+    void recordUnknownSink(S2EExecutionState *state, const char *sink, uint64_t pc,
+                           const klee::ref<klee::Expr> &cond, const char *reason);
+    void queueSinkCheck(S2EExecutionState *state, const char *sink, uint64_t pc,
+                        const klee::ref<klee::Expr> &cond, double timeout, bool retry);
+    bool getSinkCheckInputs(const PendingSinkCheck &check, ConcreteInputs &inputs);
+    bool submitSinkCheck(S2EExecutionState *state, const char *sink,
+                         uint64_t pc, const klee::ref<klee::Expr> &cond);
+    void reportSinkChecks(bool wait);
+    void onTimer();
+
+    //断言条件，初始化时编译成模板，命中时只需用参数表达式实例化。配置文件中的写法（子句之间为“或”）：
+    //sinks.<断言名> = { pc = 0x..., convention = "cdecl",
+    //    predicate = { c1 = { arg = 2, width = 32, signedness = "signed", compare = ">", bound = 0x20 } } }
+    //bound也可以是另一个参数加偏移（boundArg = 1, boundOffset = 0）；compare = "overflow"表示参数的计算
+    //发生溢出（见sizeOverflowCondition）。pc只有新增的断言才需要
+    enum SinkCompare { SinkOverflow, SinkEq, SinkNe, SinkLt, SinkLe, SinkGt, SinkGe };
+    struct SinkClause {
+        unsigned arg;
+        klee::Expr::Width width;        //参数先截断或扩展到这个位宽再比较
+        klee::OverflowSignedness mode;  //比较时只区分有无符号
+        SinkCompare compare;
+        int boundArg;                   //-1表示和常量比较
+        uint64_t bound;                 //常量或偏移，已截断到width
+        klee::ref<klee::ConstantExpr> boundExpr;
+    };
+    struct SinkPredicate {
+        ArgumentReader::Convention convention;
+        unsigned argCount;
+        std::vector<SinkClause> clauses;
+        SinkPredicate(): convention(ArgumentReader::Cdecl), argCount(0) {}
+    };
+    std::map<std::string, SinkPredicate> m_sinkPredicates;
+    //配置文件中新增的断言：地址 -> 断言名
+    std::map<uint64_t, std::string> m_configuredSinks;
+    static SinkClause makeSinkClause(unsigned arg, klee::Expr::Width width, klee::OverflowSignedness mode,
+                                     SinkCompare compare, int boundArg, uint64_t bound);
+    bool compileSinkClause(const std::string &key, klee::Expr::Width argWidth,
+                           klee::OverflowSignedness mode, SinkClause &clause);
+    void compileSinkPredicates();
+    static bool evaluateSinkClause(const SinkClause &clause, const ArgumentReader &args);
+    static klee::ref<klee::Expr> instantiateSinkClause(const SinkClause &clause, const ArgumentReader &args);
+    void assertConfiguredSink(S2EExecutionState *state, uint64_t pc);
+    bool reportSinkCondition(S2EExecutionState *state, const char *sink, uint64_t pc,
+                             const klee::ref<klee::Expr> &cond);
+
+    //断言检查：参数是具体值时直接在宿主上计算，不构造表达式也不调用求解器，
+    //只有符号化的参数才构造条件交给求解器
+    enum SinkVerdict { SinkSafe, SinkViolated, SinkSymbolic };
+    //每个断言的具体值/符号值命中次数，退出时输出
+    struct SinkHits {
+        uint64_t concrete, violated, symbolic;
+        SinkHits(): concrete(0), violated(0), symbolic(0) {}
+    };
+    std::map<std::string, SinkHits> m_sinkHits;
+    SinkVerdict evaluateSink(S2EExecutionState *state, const char *sink, uint64_t pc,
+                             const ArgumentReader &args, const SinkPredicate &predicate,
+                             klee::ref<klee::Expr> &cond);
+
+    //堆分配跟踪（配置项trackHeap）：在分配函数入口记下大小和返回地址，返回时把返回值和大小
+    //记入每个状态的堆区间表（VulMiningState），memcpy一类的断言用目的缓冲区的实际剩余大小检查长度
+    struct HeapAllocator {
+        ArgumentReader::Convention convention;
+        unsigned sizeArg;
+    };
+    //释放函数：释放的指针参数，以它为起始地址的块不再跟踪
+    struct HeapRelease {
+        ArgumentReader::Convention convention;
+        unsigned ptrArg;
+    };
+    //拷贝函数：目的参数和长度参数，lenArg为-1时长度是源字符串（srcArg）的长度
+    struct HeapCopy {
+        std::string name;
+        ArgumentReader::Convention convention;
+        unsigned dstArg;
+        int lenArg;
+        unsigned srcArg;
+    };
+    bool m_trackHeap;
+    std::map<uint64_t, HeapAllocator> m_heapAllocators;
+    std::map<uint64_t, HeapRelease> m_heapReleases;
+    std::map<uint64_t, HeapCopy> m_heapCopies;
+    //符号大小的块最多覆盖的字节数（配置项symbolicBlockMaxSize）
+    uint64_t m_symbolicBlockMax;
+    unsigned m_allocationReturnHook;
+    void initializeHeapTracking();
+    void onAllocatorCall(S2EExecutionState *state, uint64_t pc);
+    void onAllocationReturn(S2EExecutionState *state, const VulMiningShadowFrame &frame);
+    uint64_t symbolicBlockExtent(S2EExecutionState *state, uint64_t pc, const klee::ref<klee::Expr> &size,
+                                 uint64_t limit);
+    void onReleaseCall(S2EExecutionState *state, uint64_t pc);
+    void onHeapCopy(S2EExecutionState *state, uint64_t pc);
+    void checkHeapBounds(S2EExecutionState *state, const std::string &sink, uint64_t pc,
+                         const ArgumentReader &args, unsigned dstArg, int lenArg, unsigned srcArg);
+    klee::ref<klee::Expr> stringOverflowCondition(S2EExecutionState *state, uint64_t src, uint64_t remaining);
+
+    //按地址索引的插桩点：翻译每条指令时只查一次表，再连接需要的处理函数
+    enum PcHookKind { HookAllocator = 1, HookCopy = 2, HookReturn = 4, HookRelease = 8 };
+    std::map<uint64_t, unsigned> m_pcHooks;
+    void connectPcHooks(ExecutionSignal *signal,
+                        S2EExecutionState *state,
+                        TranslationBlock *tb,
+                        uint64_t pc);
+
+    //函数返回挂钩：在被拦截函数的入口把(返回地址, 挂钩编号, 参数)压入每个状态的影子栈，
+    //返回地址执行时调用挂钩的处理函数
+    typedef void (VulMining::*ReturnHandler)(S2EExecutionState *state, const VulMiningShadowFrame &frame);
+    std::vector<ReturnHandler> m_returnHandlers;
+    unsigned registerReturnHook(ReturnHandler handler);
+    bool pushReturnHook(S2EExecutionState *state, unsigned hook, uint64_t pc, const ArgumentReader &args);
+    void onReturnSite(S2EExecutionState *state, uint64_t pc);
+
+    //被拦截函数的调用约定（配置项callingConvention.<函数名>）
+    std::map<std::string, ArgumentReader::Convention> m_conventions;
+    ArgumentReader::Convention getConvention(const char *function, ArgumentReader::Convention def);
+    ArgumentReader::Convention readConvention(const std::string &key, ArgumentReader::Convention def);
+
+    //溢出后果分支由BaseInstructions分出和调度（BaseInstructions.forkOnOverflow）
+    BaseInstructions *m_baseInstructions;
+    void noteOverflowFork(S2EExecutionState *state, const char *sink);
+
+    //翻译时插桩的算术指令：指令执行后用QEMU惰性标志位的cc_src/cc_dst构造溢出条件
+    enum ArithKind { ArithAdd, ArithSub, ArithMul, ArithShl };
+    struct ArithInstruction {
+        ArithKind kind;
+        klee::Expr::Width width;
+    };
+    bool m_inlineOverflow;
+    klee::OverflowSignedness m_inlineSignedness;
+    //被插桩的模块地址范围[start, end)
+    std::vector<std::pair<uint64_t, uint64_t> > m_inlineRanges;
+    uint64_t m_arithTranslations;   //插桩的翻译次数
+    uint64_t m_inlineConcreteHits, m_inlineSymbolicHits;
+    //已经得出确定结论的算术检查，所有状态共用，按指纹查找，指纹相同时再精确比较键。
+    //最多保存m_inlineDedupCapacity项（配置项inlineOverflowDedupSize），按LRU淘汰；
+    //超时或未知的条件不记录，下次执行到时重新检查
+    struct CheckedArith {
+        ArithCheckKey key;
+        std::list<uint64_t>::iterator lru;
+    };
+    bool m_inlineDedup;
+    unsigned m_inlineDedupCapacity;
+    std::map<uint64_t, CheckedArith> m_checkedAriths;
+    std::list<uint64_t> m_checkedArithLru;     //最近命中的指纹在前
+    static ArithCheckKey makeArithCheckKey(uint64_t pc, ArithInstruction insn,
+                                           const klee::ref<klee::Expr> &src, const klee::ref<klee::Expr> &dst);
+    bool isArithChecked(const ArithCheckKey &key);
+    void noteArithChecked(const ArithCheckKey &key);
+    uint64_t m_inlineDuplicateHits;
+    sigc::connection m_onTranslateInstructionEnd;
+
+    //静态算术指令表：一次性反汇编整个范围（target_disas），把算术指令的偏移、种类和位宽
+    //按偏移排序写入文件，之后映射到内存，翻译时二分查找，作为插桩白名单
+    struct ArithSiteRecord {
+        uint32_t offset;    //相对范围起始地址
+        uint8_t kind;       //ArithKind
+        uint8_t width;
+        uint16_t reserved;
+    };
+    static bool arithSiteLess(const ArithSiteRecord &a, const ArithSiteRecord &b) {
+        return a.offset < b.offset;
+    }
+    struct ArithSiteMap {
+        const ArithSiteRecord *sites;
+        uint64_t count;
+        void *mapping;
+        size_t mappingSize;
+        bool loaded, failed;
+        unsigned retryIn;   //模块还有页面未载入时，再翻译多少条指令后重试
+    };
+    std::string m_arithSiteMapDir;
+    std::vector<ArithSiteMap> m_arithSiteMaps;   //与m_inlineRanges一一对应
+
+    int findInlineRange(uint64_t pc) const;
+    std::string getArithSiteMapPath(unsigned range) const;
+    bool checksumArithRange(S2EExecutionState *state, unsigned range, uint64_t &checksum);
+    bool buildArithSiteMap(unsigned range, const std::string &path, uint64_t checksum);
+    bool loadArithSiteMap(unsigned range, uint64_t checksum);
+    const ArithSiteRecord *findArithSite(S2EExecutionState *state, unsigned range, uint64_t pc);
+    static bool parseArithmetic(const std::string &line, uint64_t &address, ArithInstruction &insn);
+    static bool decodeArithmetic(const uint8_t *code, unsigned size, ArithInstruction &insn);
+    void onTranslateArithmetic(ExecutionSignal *signal,
+                               S2EExecutionState *state,
+                               TranslationBlock *tb,
+                               uint64_t pc);
+    void checkArithmetic(S2EExecutionState *state, uint64_t pc, ArithInstruction insn);
+
 public:
-    VulMining(S2E* s2e): Plugin(s2e) {}//这里是需要修改的一个地方
+    VulMining(S2E* s2e): Plugin(s2e), m_asyncSinks(false), m_inlineOverflow(false),
+        m_inlineSignedness(klee::AnyOverflow), m_arithTranslations(0), m_inlineConcreteHits(0), m_inlineSymbolicHits(0),
+        m_inlineDedup(true), m_inlineDedupCapacity(0), m_inlineDuplicateHits(0), m_baseInstructions(NULL), m_trackHeap(false),
+        m_symbolicBlockMax(0), m_allocationReturnHook(0) {}//这里是需要修改的一个地方
     virtual ~VulMining();
     void initialize();
 
@@ -151,7 +393,65 @@ public:
 
 };
 
-
+//VulMining每个状态的数据，分支时随状态复制
+class VulMiningState: public PluginState
+{
+public:
+    //堆上分配的一块内存，size为符号值时sizeExpr非空。size是归到这一块的地址范围：
+    //符号大小的块为大小的最大可能值，但不超过symbolicBlockMaxSize，也不延伸到其他块上
+    struct HeapBlock {
+        uint64_t size;
+        klee::ref<klee::Expr> sizeExpr;
+        uint64_t pc;
+    };
+    //按起始地址排序，块之间不重叠，查找包含某个地址的块是O(log n)
+    typedef std::map<uint64_t, HeapBlock> HeapMap;
+    HeapMap heap;
+
+    //已进入、尚未返回的被拦截函数
+    std::vector<VulMiningShadowFrame> shadowStack;
+
+    void addBlock(uint64_t start, const HeapBlock &block) {
+        //地址被重新分配时，去掉与新块重叠的旧块（没有跟踪到释放的块）；
+        //符号大小的块的范围只是上界，不去掉，只缩到新块之前
+        uint64_t end = start + block.size;
+        HeapMap::iterator it = heap.lower_bound(start);
+        if (it != heap.begin()) {
+            HeapMap::iterator prev = it;
+            --prev;
+            if (prev->first + prev->second.size > start) {
+                if (prev->second.sizeExpr.isNull())
+                    it = prev;
+                else
+                    prev->second.size = start - prev->first;
+            }
+        }
+        while (it != heap.end() && it->first < end)
+            heap.erase(it++);
+        heap[start] = block;
+    }
+
+    //start之后的第一个块的起始地址，没有时返回0
+    uint64_t nextBlock(uint64_t start) const {
+        HeapMap::const_iterator it = heap.upper_bound(start);
+        return it == heap.end() ? 0 : it->first;
+    }
+
+    //包含address的块；符号大小的块以它的地址范围size为界
+    const HeapBlock *findBlock(uint64_t address, uint64_t &start) const {
+        HeapMap::const_iterator it = heap.upper_bound(address);
+        if (it == heap.begin())
+            return NULL;
+        --it;
+        if (address - it->first >= it->second.size)
+            return NULL;
+        start = it->first;
+        return &it->second;
+    }
+
+    virtual VulMiningState *clone() const { return new VulMiningState(*this); }
+    static PluginState *factory(Plugin *p, S2EExecutionState *s) { return new VulMiningState(); }
+};
 
 } // namespace plugins
 } // namespace s2e